@@ -54,4 +54,11 @@ do { \
 #  define irq_set_irq_type set_irq_type
 #endif
 
+#if LINUX_VERSION_CODE < KERNEL_VERSION(3, 13, 0)
+/* seqcount lockdep init came with v3.13, nothing to do before */
+#  define u64_stats_init(syncp) do { } while (0)
+/* ... and reinit_completion() replaced INIT_COMPLETION() */
+#  define reinit_completion(x) INIT_COMPLETION(*(x))
+#endif
+
 #endif /*  _ACX_COMPAT_H_ */
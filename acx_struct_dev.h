@@ -20,6 +20,9 @@
 
 #include "acx_struct_hw.h"
 #include <linux/wireless.h>
+#include <linux/completion.h>
+#include <linux/hrtimer.h>
+#include <linux/u64_stats_sync.h>
 #include <net/mac80211.h>
 
 /*
@@ -58,6 +61,22 @@ enum {
 
 extern unsigned int acx_hwcrypto;
 extern unsigned int acx_watchdog_enable;
+extern int acx_tx_batch;
+extern unsigned int acx_tx_stop_queue;
+extern unsigned int acx_rx_descs;
+extern unsigned int acx_mem_block_size;
+extern int acx_mem_split;
+extern unsigned int acx_tx_descs;
+extern unsigned int acx_tx_start_queue;
+extern unsigned int acx_tx_zerocopy;
+extern unsigned int acx_rx_zerocopy;
+extern int acx_rx_budget;
+extern unsigned int acx_irq_iterate;
+extern unsigned int acx_fw_fast;
+extern int acx_rx_coalesce;
+extern unsigned int acx_usb_tx_urbs;
+extern unsigned int acx_usb_rx_urbs;
+extern unsigned int acx_usb_tx_agg;
 
 /*
  * BOM Constants
@@ -145,6 +164,28 @@ extern unsigned int acx_watchdog_enable;
 #define RX_CNT 16
 #define TX_CNT 16
 
+/* RX_CNT/TX_CNT are only the defaults: the descs per ring are set at
+ * probe time from the rxdescs/txdescs module params, see
+ * acx_init_ring_sizes(). Ring sizes are powers of two, so indices
+ * wrap with adev->rx_mask/tx_mask. */
+#define ACX_RING_MIN	8
+#define ACX_RING_MAX	64
+/* acx100: share of the QueueStart..PoolEnd memory the desc rings may
+ * take, the rest is the tx/rx buffer pool */
+#define ACX100_RING_AREA_SHARE	4	/* 1/4 */
+
+/* acx100 memory pool, see acx100_init_memory_pools(): block sizes
+ * allowed by the memblocksize param, and the tx share of the blocks
+ * in percent. In auto mode the split moves by ACX100_MEM_SPLIT_STEP
+ * on each acx_init_mac(), towards the side that ran short. */
+#define ACX_MEM_BLOCK_MIN		128
+#define ACX_MEM_BLOCK_MAX		512
+#define ACX100_MEM_SPLIT_AUTO		(-1)
+#define ACX100_MEM_SPLIT_DEFAULT	50
+#define ACX100_MEM_SPLIT_MIN		20
+#define ACX100_MEM_SPLIT_MAX		80
+#define ACX100_MEM_SPLIT_STEP		10
+
 /* we clean up txdescs when we have N free txdesc: */
 #define TX_CLEAN_BACKLOG (TX_CNT/4)
 #define TX_START_CLEAN (TX_CNT - TX_CLEAN_BACKLOG)
@@ -153,9 +194,130 @@ extern unsigned int acx_watchdog_enable;
 #define TX_STOP_QUEUE 3
 /* we start queue if we have >= N free txbufs: */
 #define TX_START_QUEUE 5
+/* Both are per hw queue, and can be changed with the txstop and
+ * txstart module params, see acx_tx_stop_limit() */
 
 #define ACX_TX_QUEUE_MAX_LENGTH 20
 
+/* mac80211 tx queues, one per access category, 0 (VO) has the
+ * highest priority. See acx_tx_queue_id() for the hw queues. */
+#define ACX_NUM_ACS		4
+
+/* Tx batching: frames handed to the acx per INT_TRIG_TXPRC doorbell,
+ * in auto mode up to the tx ring size, see acx_tx_batch_limit().
+ * The last histogram bucket also counts all larger batches. */
+#define ACX_TX_BATCH_AUTO	(-1)
+#define ACX_TX_BATCH_HIST_LEN	16
+
+/* Zero-copy tx (PCI): frames up to this size are still copied into the
+ * coherent txbuf, mapping them costs more than the memcpy */
+#define ACX_TX_COPYBREAK	256
+
+/* Zero-copy rx (PCI): frames up to this size are copied into a fresh
+ * skb and the mapped one stays on the rxhostdesc */
+#define ACX_RX_COPYBREAK	256
+
+/* Budgeted rx polling: max rx descs handled per acx_irq_work() pass,
+ * irqs stay masked until the ring is drained (0: no limit). In auto
+ * mode half the rx ring, see acx_rx_budget_limit(). */
+#define ACX_RX_BUDGET_AUTO	(-1)
+
+/* Irq iteration: extra passes acx_irq_work() may make over
+ * IO_ACX_IRQ_REASON, handling new events and sending queued tx
+ * frames inline (irqiterate param) */
+#define ACX_IRQ_ITERATE_MAX	16
+
+/* Timed phases of bringing the device up, see the boot debugfs
+ * file. FW_WRITE and FW_VERIFY are those of the last upload try. */
+enum acx_boot_phase {
+	ACX_BOOT_FW_WRITE,
+	ACX_BOOT_FW_VERIFY,
+	ACX_BOOT_ECPU,		/* eCPU start after the upload */
+	ACX_BOOT_RADIO,		/* radio upload and init */
+	ACX_BOOT_INIT_MAC,	/* all of acx_init_mac(), incl. RADIO */
+	ACX_BOOT_PHASES
+};
+
+/* Timed phases of a resume, see acx_resume_hw(). The fw upload
+ * inside RESET shows in the boot phases. */
+enum acx_resume_phase {
+	ACX_RESUME_RESET,	/* acx_full_reset() */
+	ACX_RESUME_REPLAY,	/* settings snapshot replay */
+	ACX_RESUME_REGISTER,	/* ieee80211_register_hw() */
+	ACX_RESUME_TOTAL,
+	ACX_RESUME_PHASES
+};
+
+/* Rx irq coalescing, see acx_rx_coal_update(). Adaptive: below
+ * ACX_RX_COAL_LOW_RATE rx frames/s the rx irq is rearmed at once,
+ * above it late enough to collect about half a ring per irq. Fixed
+ * delays are capped to ACX_RX_COAL_MAX_USECS. */
+#define ACX_RX_COAL_ADAPTIVE	(-1)
+#define ACX_RX_COAL_LOW_RATE	1000
+#define ACX_RX_COAL_ADAPT_USECS	500
+#define ACX_RX_COAL_MAX_USECS	10000
+#define ACX_RX_COAL_SAMPLE	(HZ / 4)
+
+/* USB tx urbs, see acxusb_alloc_tx(). The free slots are kept in a
+ * single unsigned long bitmap, and we need at least TX_START_QUEUE
+ * of them, or the queue is never woken again. */
+#define ACX_TX_URB_CNT		8
+#define ACX_TX_URB_MIN		TX_START_QUEUE
+#define ACX_TX_URB_MAX		32
+
+/* USB bulk-in urbs kept in flight, see acxusb_complete_rx() */
+#define ACX_RX_URB_CNT		4
+#define ACX_RX_URB_MIN		2
+#define ACX_RX_URB_MAX		16
+
+/* USB tx aggregation: frames packed back to back into one bulk-out
+ * transfer, see acxusb_tx_kick(). One aggregate is filled while the
+ * other one is in flight. */
+#define ACX_USB_TX_AGG_LEN	4096
+#define ACX_USB_TX_AGG_BUFS	2
+
+typedef struct usb_tx_agg {
+	struct urb	*urb;
+	acx_device_t	*adev;
+	u8		*buf;
+	unsigned int	len;		/* bytes packed, not submitted yet */
+	unsigned int	nslots;
+	u8		slot[ACX_TX_URB_MAX];	/* usb_tx[] slots packed */
+} usb_tx_agg_t;
+
+/* Fw command latency histogram, see acx_issue_cmd_timeout(): one
+ * row per enum acx_cmd, bucket n counts latencies below 32us << n,
+ * the last one all slower commands */
+#define ACX_CMD_LAT_CMDS	32
+#define ACX_CMD_LAT_BUCKETS	12
+
+/* IE shadow, see acx_configure_len() and acx_interrogate(): the last
+ * value per IE that the fw has, or that is queued in a configure
+ * transaction. Larger IEs are not shadowed. */
+#define ACX_IE_SHADOW_MAX	80
+#define ACX_IE_SHADOW_LEN	32
+
+struct acx_ie_shadow {
+	u8	valid;		/* data is what the fw has */
+	u8	dirty;		/* data is queued, not written yet */
+	u8	cached;		/* data was interrogated, see acx_interrogate_cached() */
+	u8	configured;	/* by us since the fw reset */
+	u16	len;
+	u32	seq;		/* order of the last configure */
+	u8	data[ACX_IE_SHADOW_LEN];
+};
+
+/* Configured IE state saved at suspend, see acx_cfg_snapshot() */
+struct acx_ie_snap {
+	u8	type;
+	u16	len;
+	u32	seq;
+	u8	data[ACX_IE_SHADOW_LEN];
+};
+
+/* Per-rate tx counters: mac80211 rate index, 4 CCK + 8 OFDM */
+#define ACX_STATS_RATES		12
+
 /*
  * BOM Global data
  * ==================================================
@@ -169,6 +331,27 @@ enum {
 	acx_reg_domain_ids_len = 8
 };
 
+/*
+ * BOM Statistics
+ * ==================================================
+ */
+
+/* Hot path tx/rx counters. Kept per cpu, since tx_work, irq_work
+ * and USB urb completions all count. Summed by acx_stats_fold(). */
+struct acx_stats_counters {
+	u64	rx_packets;
+	u64	rx_bytes;
+	u64	tx_packets;
+	u64	tx_bytes;
+	u64	tx_queue_packets[ACX111_MAX_NUM_HW_TX_QUEUES];
+	u64	tx_rate_packets[ACX_STATS_RATES];
+};
+
+struct acx_pcpu_stats {
+	struct acx_stats_counters c;
+	struct u64_stats_sync	syncp;
+};
+
 /*
  * BOM Main acx per-device data structure
  * ==================================================
@@ -220,6 +403,20 @@ struct hw_tx_queue {
 		size_t size;
 		dma_addr_t phy;
 	} bufinfo;
+
+	/* Flow control: ACs stopped, because this queue ran full. On
+	 * USB the wake runs from the urb completion, unlocked. */
+	unsigned long stopped_acs;
+	atomic_t stops;
+	atomic_t wakes;
+};
+
+/* MEM: host mirror of a txbuf block on the acx, see
+ * acxmem_allocate_acx_txbuf_space() */
+struct acxmem_txbuf_blk {
+	u16 next;	/* next block in the chain */
+	u16 last;	/* chain head: last block of the chain */
+	u16 count;	/* chain head: blocks in the chain, 0: not a head */
 };
 
 struct hw_rx_queue {
@@ -294,11 +491,39 @@ struct acx_device {
 	u8 *ie_cmd_buf;
 	int ie_cmd_buf_len;
 
+	/* PCI: completed by acx_interrupt() on HOST_INT_CMD_COMPLETE */
+	struct completion	cmd_done;
+	unsigned long	cmd_lat_hist[ACX_CMD_LAT_CMDS][ACX_CMD_LAT_BUCKETS];
+	unsigned long	cmd_lat_max_us[ACX_CMD_LAT_CMDS];
+
+	/* Configure transactions, see acx_cfg_begin() */
+	struct acx_ie_shadow	ie_shadow[ACX_IE_SHADOW_MAX];
+	u8		cfg_txn_queue[ACX_IE_SHADOW_MAX];	/* dirty IEs, in order */
+	unsigned int	cfg_txn_queued;
+	unsigned int	cfg_txn;		/* nesting depth */
+	int		cfg_txn_res;
+	unsigned long	cfg_cmds_saved;
+	unsigned long	cfg_cmds_written;
+	unsigned long	ie_cache_hits;
+	u32		cfg_seq;
+	/* IE values interrogated before we configured them: the fw
+	 * defaults, kept across fw resets */
+	struct acx_ie_shadow	ie_default[ACX_IE_SHADOW_MAX];
+	struct acx_ie_snap	resume_snap[ACX_IE_SHADOW_MAX];
+	unsigned int	resume_snap_cnt;
+	u8		resume_fresh;		/* fw set up by resume, see acx_op_start() */
+	unsigned int	resumes;
+	unsigned int	resume_written;		/* last replay */
+	unsigned int	resume_skipped;
+	u64		resume_ns[ACX_RESUME_PHASES];
+
 	/* wireless device statistics */
 	struct ieee80211_low_level_stats	ieee_stats;
 
-	/* net device statistics */
+	/* net device statistics, packet and byte counts are folded in
+	 * from pcpu_stats by acx_stats_fold() */
 	struct net_device_stats	stats;
+	struct acx_pcpu_stats __percpu *pcpu_stats;
 
 #ifdef WIRELESS_EXT
 /* 	struct iw_statistics	wstats;		// wireless statistics */
@@ -399,8 +624,52 @@ struct acx_device {
  */
 
 	/* Mac80211 Tx_queue */
-	struct sk_buff_head tx_queue;
+	struct sk_buff_head tx_queue[ACX_NUM_ACS];	/* per AC */
+	struct ieee80211_tx_queue_params tx_ac_params[ACX_NUM_ACS];
 	struct work_struct tx_work;
+	u8		tx_zerocopy;		/* DMA mask allows _acx_tx_map_skb() */
+
+	/* Tx batching, see acx_tx_queue_go() */
+	u8		tx_batching;		/* defer doorbell in _acx_tx_data() */
+	unsigned int	tx_batch_pending;	/* frames given to hw, doorbell not rung yet */
+	unsigned long	tx_doorbells;
+	unsigned long	tx_batch_hist[ACX_TX_BATCH_HIST_LEN];
+
+	/* Zero-copy rx, see acxpci_process_rxdesc() */
+	struct sk_buff_head rx_skb_pool;
+	unsigned long	rx_zerocopy_frames;
+	unsigned long	rx_copybreak_frames;
+	unsigned long	rx_refill_failures;
+
+	/* Budgeted rx polling, see acx_irq_work() */
+	u8		rx_polling;		/* acx_rx() queues on rx_poll_list */
+	u8		rx_poll_pending;	/* budget ran out, ring not drained */
+	struct sk_buff_head rx_poll_list;
+	unsigned long	rx_polls;
+	unsigned long	rx_poll_frames;
+	unsigned long	rx_budget_exhausted;
+	unsigned long	irq_rearms;
+
+	/* Rx irq coalescing, see acx_rx_coal_update() */
+	struct hrtimer	rx_coal_timer;		/* rearms rx, see acx_irq_work() */
+	int		rx_coal_mode;		/* ACX_RX_COAL_ADAPTIVE or usecs */
+	unsigned int	rx_coal_usecs;		/* current rx rearm delay */
+	u8		rx_coal_pending;	/* rx irq masked until the timer */
+	unsigned long	rx_coal_delays;
+	unsigned long	rx_coal_stamp;		/* jiffies of the last sample */
+	unsigned long	rx_coal_frames;
+	unsigned long	rx_coal_frames_last;
+	unsigned long	irq_count;		/* acx_interrupt() handled */
+	unsigned long	irq_count_last;
+	unsigned int	rx_rate;		/* rx frames/s, last sample */
+	unsigned int	irq_rate;		/* irqs/s, last sample */
+
+	/* Irq iteration, see acx_irq_work(). irq_passes[n]: calls that
+	 * made n + 1 passes */
+	unsigned long	irq_works;
+	unsigned long	irq_passes[ACX_IRQ_ITERATE_MAX + 1];
+	u64		irq_work_ns;
+	u64		irq_work_max_ns;
 
 #ifdef UNUSED
 	int		dup_count;
@@ -481,12 +750,26 @@ struct acx_device {
 	u16		memblocksize;
 	u16		phy_header_len;
 
+	/* acx100 tx/rx memory pool split, see acx100_init_memory_pools() */
+	unsigned int	mem_tx_pct;
+	unsigned int	mem_tx_blocks;
+	unsigned int	mem_rx_blocks;
+	unsigned long	mem_tx_starved;		/* tx without free txbuf blocks */
+	unsigned long	mem_rx_full;		/* rx ring found full */
+	unsigned long	mem_tx_starved_last;	/* at the last partition */
+	unsigned long	mem_rx_full_last;
+	unsigned long	txclean_descs;		/* txdescs cleaned (MEM) */
+	unsigned long	txclean_mmio;		/* register accesses for it */
+
 	/* debugfs */
 	struct dentry	*debugfs_dir;
 
 	/* Firmware */
 	firmware_image_t *fw_image;
 	firmware_image_t *radio_image;
+	unsigned int	fw_tries;		/* last upload: tries needed */
+	u8		fw_fast;		/* ... and done in fast mode */
+	u64		boot_ns[ACX_BOOT_PHASES];
 
 /*************************************************************************
  *** PCI/USB/... must be last or else hw agnostic code breaks horribly ***
@@ -496,10 +779,16 @@ struct acx_device {
 	int acx_txbuf_numblocks;
 	u32 acx_txbuf_free;		/* addr of head of free list */
 	int acx_txbuf_blocks_free;	/* how many are still open */
+	struct acxmem_txbuf_blk *acx_txbuf_blk;	/* per block mirror */
+	int acx_txbuf_blk_cap;		/* entries allocated */
 	queueindicator_t *acx_queue_indicator;
 #endif
 
 	struct hw_rx_queue hw_rx_queue;
+	unsigned int rx_cnt;		/* descs per ring, power of two */
+	unsigned int rx_mask;
+	unsigned int tx_cnt;
+	unsigned int tx_mask;
 	int num_hw_tx_queues;
 	/* pointers to tx buffers, tx host descriptors (in host
 	 * memory) and tx descs in device memory, same for rx */
@@ -547,6 +836,19 @@ struct acx_device {
 
 	usb_tx_t	*usb_tx;
 	usb_rx_t	*usb_rx;
+	unsigned int	usb_tx_cnt;		/* tx urbs in usb_tx[] */
+	unsigned long	usb_tx_free_map;	/* bit set: usb_tx[] slot free */
+	atomic_t	usb_tx_free;		/* free slots, see acx_tx_queue_free() */
+	unsigned int	usb_rx_cnt;		/* rx urbs in usb_rx[] */
+	atomic_t	usb_rx_inflight;
+	u32		usb_rx_seq_submit;	/* seq of the next submitted rx urb */
+	u32		usb_rx_seq_expect;	/* seq of the next rx urb to complete */
+	unsigned long	usb_rx_starved;		/* completions with none left in flight */
+	unsigned long	usb_rx_misordered;
+	unsigned long	usb_rx_lost;		/* urbs dropped from the ring */
+	usb_tx_agg_t	usb_tx_agg[ACX_USB_TX_AGG_BUFS];
+	unsigned int	usb_tx_agg_cur;		/* the one being filled */
+	unsigned long	usb_tx_agg_busy;	/* bit set: usb_tx_agg[] urb in flight */
 
 	int		bulkinep;	/* bulk-in endpoint */
 	int		bulkoutep;	/* bulk-out endpoint */
@@ -643,12 +643,19 @@ struct txhostdesc {
 	/* From here on you can use this area as you want (variable length, too!) */
 	u8	*data;
 	struct sk_buff *skb;
+	/* zero-copy tx: skb->data is DMA-mapped, hd.data_phy points into it */
+	dma_addr_t skb_phy;
+	unsigned int skb_maplen;	/* 0 if not mapped */
 } ACX_PACKED;
 
 struct rxhostdesc {
 	struct hostdesc hd;
 	/* From here on you can use this area as you want (variable length, too!) */
 	rxbuffer_t *data;
+	/* zero-copy rx: data points into this DMA-mapped skb, NULL if the
+	 * desc uses its slot in the coherent rxbuf area */
+	struct sk_buff *skb;
+	dma_addr_t skb_phy;
 } ACX_PACKED;
 
 #endif /* ACX_PCI */
@@ -691,7 +698,6 @@ typedef struct usb_txstatus {
 } ACX_PACKED usb_txstatus_t;
 
 typedef struct usb_tx {
-	unsigned	busy:1;
 	struct urb	*urb;
 	acx_device_t	*adev;
 	struct sk_buff *skb;
@@ -703,6 +709,7 @@ struct usb_rx_plain {
 	unsigned	busy:1;
 	struct urb	*urb;
 	acx_device_t	*adev;
+	u32		seq;
 	rxbuffer_t	bulkin;
 };
 
@@ -710,6 +717,7 @@ typedef struct usb_rx {
 	unsigned	busy:1;
 	struct urb	*urb;
 	acx_device_t	*adev;
+	u32		seq;		/* submit order, see acxusb_poll_rx() */
 	rxbuffer_t	bulkin;
 	/* Make entire structure 4k */
 	u8 padding[4*1024 - sizeof(struct usb_rx_plain)];
@@ -20,6 +20,10 @@
 
 #include <linux/vmalloc.h>
 #include <linux/firmware.h>
+#include <linux/list.h>
+#include <linux/mutex.h>
+#include <linux/slab.h>
+#include <linux/ktime.h>
 
 #include "acx.h"
 #include "usb.h"
@@ -226,6 +230,106 @@ firmware_image_t *acx_read_fw(struct device *dev, const char *file, u32 * size)
 	return res;
 }
 
+/*
+ * Firmware cache
+ *
+ * Images read by acx_get_fw() are kept module-wide by filename and
+ * shared by all devices holding a reference, so further cards (and
+ * USB uploads while another card holds the image) don't go to the
+ * filesystem again. Devices keep their references until removed, so
+ * resume and acx_recover_hw() never reload. The last acx_put_fw()
+ * frees the image.
+ */
+struct acx_fw_cache_entry {
+	struct list_head list;
+	firmware_image_t *image;
+	u32 size;
+	unsigned int refs;
+	char name[];
+};
+
+static LIST_HEAD(acx_fw_cache);
+static DEFINE_MUTEX(acx_fw_cache_mutex);
+
+static struct acx_fw_cache_entry *acx_fw_cache_lookup(const char *file)
+{
+	struct acx_fw_cache_entry *e;
+
+	list_for_each_entry(e, &acx_fw_cache, list)
+		if (!strcmp(e->name, file))
+			return e;
+
+	return NULL;
+}
+
+/*
+ * Returns a reference to the cached image of file. If it isn't
+ * cached and !cached_only, it is read with acx_read_fw() and added.
+ */
+firmware_image_t *acx_get_fw(struct device *dev, const char *file, u32 *size,
+			int cached_only)
+{
+	struct acx_fw_cache_entry *e;
+	firmware_image_t *image = NULL;
+
+	mutex_lock(&acx_fw_cache_mutex);
+
+	e = acx_fw_cache_lookup(file);
+	if (e) {
+		log(L_INIT, "firmware image '%s' cached, %u users\n",
+			file, e->refs);
+		goto found;
+	}
+	if (cached_only)
+		goto end;
+
+	e = kzalloc(sizeof(*e) + strlen(file) + 1, GFP_KERNEL);
+	if (!e)
+		goto end;
+
+	e->image = acx_read_fw(dev, file, &e->size);
+	if (!e->image) {
+		kfree(e);
+		goto end;
+	}
+	strcpy(e->name, file);
+	list_add(&e->list, &acx_fw_cache);
+
+found:
+	e->refs++;
+	*size = e->size;
+	image = e->image;
+end:
+	mutex_unlock(&acx_fw_cache_mutex);
+
+	return image;
+}
+
+void acx_put_fw(firmware_image_t *image)
+{
+	struct acx_fw_cache_entry *e;
+
+	if (!image)
+		return;
+
+	mutex_lock(&acx_fw_cache_mutex);
+
+	list_for_each_entry(e, &acx_fw_cache, list) {
+		if (e->image != image)
+			continue;
+		if (!--e->refs) {
+			log(L_INIT, "dropping firmware image '%s'\n", e->name);
+			list_del(&e->list);
+			vfree(e->image);
+			kfree(e);
+		}
+		goto end;
+	}
+	pr_err("BUG: firmware image %p isn't cached\n", image);
+end:
+	mutex_unlock(&acx_fw_cache_mutex);
+}
+
 /*
  * Common function to parse ALL configoption struct formats
  * (ACX100 and ACX111; FIXME: how to make it work with ACX100 USB!?!?).
@@ -485,12 +589,42 @@ int acx_full_reset(acx_device_t *adev)
 
 }
 
+/*
+ * Brings the device back after a suspend: fw upload and init_mac as
+ * usual, then the settings snapshot taken at suspend is replayed, see
+ * acx_cfg_replay(). The next acx_op_start() then neither resets the
+ * fw again nor rewrites settings it already has.
+ */
+int acx_resume_hw(acx_device_t *adev)
+{
+	ktime_t t0 = ktime_get();
+	int res;
+
+	res = acx_full_reset(adev);
+	adev->resume_ns[ACX_RESUME_RESET] =
+		ktime_to_ns(ktime_sub(ktime_get(), t0));
+	if (res)
+		return res;
+
+	t0 = ktime_get();
+	acx_cfg_replay(adev);
+	adev->resume_ns[ACX_RESUME_REPLAY] =
+		ktime_to_ns(ktime_sub(ktime_get(), t0));
+
+	adev->resume_fresh = 1;
+	adev->resumes++;
+
+	return OK;
+}
+
 int acx_reset_on_probe(acx_device_t *adev)
 {
 	int res=0;
 	acx111_ie_configoption_t co;
 	acxmem_lock_flags;
 
+	acx_init_ring_sizes(adev);
+
 	/* reset_dev */
 	if ((res=acx_reset_dev(adev)))
 		goto end_fail;
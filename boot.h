@@ -4,6 +4,9 @@
 void acx_get_firmware_version(acx_device_t * adev);
 void acx_display_hardware_details(acx_device_t *adev);
 firmware_image_t *acx_read_fw(struct device *dev, const char *file, u32 * size);
+firmware_image_t *acx_get_fw(struct device *dev, const char *file, u32 *size,
+			int cached_only);
+void acx_put_fw(firmware_image_t *image);
 void acx_parse_configoption(acx_device_t *adev,
                             const acx111_ie_configoption_t *pcfg);
 
@@ -11,6 +14,7 @@ int acx_read_phy_reg(acx_device_t *adev, u32 reg, u8 *charbuf);
 int acx_write_phy_reg(acx_device_t *adev, u32 reg, u8 value);
 
 int acx_full_reset(acx_device_t *adev);
+int acx_resume_hw(acx_device_t *adev);
 int acx_reset_on_probe(acx_device_t *adev);
 
 #endif
@@ -403,7 +403,7 @@ int acx1xx_get_tx_level(acx_device_t *adev)
 
 	memset(&tx_level, 0, sizeof(tx_level));
 
-	if (OK != acx_interrogate(adev, &tx_level,
+	if (OK != acx_interrogate_cached(adev, &tx_level,
 					ACX1xx_IE_DOT11_TX_POWER_LEVEL)) {
 
 		return NOT_OK;
@@ -562,7 +562,7 @@ int acx1xx_get_antenna(acx_device_t *adev)
 	u8 *antenna=adev->ie_cmd_buf;
 
 	memset(antenna, 0, adev->ie_cmd_buf_len);
-	res = acx_interrogate(adev, antenna,
+	res = acx_interrogate_cached(adev, antenna,
 			  ACX1xx_IE_DOT11_CURRENT_ANTENNA);
 	adev->antenna[0] = antenna[4];
 	adev->antenna[1] = antenna[5];
@@ -716,7 +716,8 @@ int acx1xx_get_station_id(acx_device_t *adev)
 	const u8 *paddr;
 	int i, res;
 
-	res = acx_interrogate(adev, stationID, ACX1xx_IE_DOT11_STATION_ID);
+	res = acx_interrogate_cached(adev, stationID,
+				ACX1xx_IE_DOT11_STATION_ID);
 	paddr = &stationID[4];
 	for (i = 0; i < ETH_ALEN; i++) {
 		/* we copy the MAC address (reversed in the card) to
@@ -772,7 +773,7 @@ static int acx100_get_ed_threshold(acx_device_t *adev)
 	u8 *ed_threshold = adev->ie_cmd_buf;
 
 	memset(ed_threshold, 0, sizeof(adev->ie_cmd_buf_len));
-	res = acx_interrogate(adev, ed_threshold,
+	res = acx_interrogate_cached(adev, ed_threshold,
 			  ACX100_IE_DOT11_ED_THRESHOLD);
 	adev->ed_threshold = ed_threshold[4];
 
@@ -851,7 +852,7 @@ static int acx100_get_cca(acx_device_t *adev)
 	u8 *cca = adev->ie_cmd_buf;
 
 	memset(cca, 0, sizeof(adev->ie_cmd_buf_len));
-	res = acx_interrogate(adev, cca,
+	res = acx_interrogate_cached(adev, cca,
 			ACX1xx_IE_DOT11_CURRENT_CCA_MODE);
 	adev->cca = cca[4];
 
@@ -929,7 +930,7 @@ static int acx1xx_get_rate_fallback(acx_device_t *adev)
 
 
 	memset(rate, 0, sizeof(rate));
-	res = acx_interrogate(adev, &rate,
+	res = acx_interrogate_cached(adev, &rate,
 			ACX1xx_IE_RATE_FALLBACK);
 	adev->rate_auto = rate[4];
 
@@ -1144,6 +1145,55 @@ int acx111_set_recalib_auto(acx_device_t *adev, int enable)
 	return(acx111_update_recalib_auto(adev));
 }
 
+/* AC a is sent before AC b: shorter aifs, then smaller cw_min */
+static int acx_ac_before(acx_device_t *adev, int a, int b)
+{
+	const struct ieee80211_tx_queue_params *pa = &adev->tx_ac_params[a];
+	const struct ieee80211_tx_queue_params *pb = &adev->tx_ac_params[b];
+
+	if (pa->aifs != pb->aifs)
+		return pa->aifs < pb->aifs;
+	if (pa->cw_min != pb->cw_min)
+		return pa->cw_min < pb->cw_min;
+	return a < b;
+}
+
+/*
+ * acx111: hw tx queue priorities from the EDCA params of acx_conf_tx().
+ * Queue 1 + ac carries the encrypted frames of AC ac, see
+ * acx_tx_queue_id(). Higher attributes are served first, the NOENC
+ * queue (mgmt frames) keeps the highest one. Without params all ACs
+ * tie and the order is the one of the memory config.
+ */
+int acx111_update_queue_prio(acx_device_t *adev)
+{
+	acx111_ie_queueconfig_t queueconf;
+	int ac, other, rank;
+
+	if (!IS_ACX111(adev) || adev->num_hw_tx_queues <= ACX_NUM_ACS)
+		return OK;
+
+	/* The queue addresses are the fw's, only the attributes change */
+	memset(&queueconf, 0, sizeof(queueconf));
+	if (OK != acx_interrogate(adev, &queueconf, ACX111_IE_QUEUE_CONFIG))
+		return NOT_OK;
+
+	queueconf.tx_queue[NOENC_QUEUE_ID].attributes =
+		ACX111_NUM_HW_TX_QUEUES - 1;
+	for (ac = 0; ac < ACX_NUM_ACS; ac++) {
+		rank = 0;
+		for (other = 0; other < ACX_NUM_ACS; other++)
+			if (other != ac && acx_ac_before(adev, other, ac))
+				rank++;
+		queueconf.tx_queue[1 + ac].attributes =
+			ACX111_NUM_HW_TX_QUEUES - 2 - rank;
+		log(L_INIT, "tx queue %d (ac %d): attributes %u\n", 1 + ac,
+			ac, queueconf.tx_queue[1 + ac].attributes);
+	}
+
+	return acx_configure(adev, &queueconf, ACX111_IE_QUEUE_CONFIG);
+}
+
 #ifdef UNUSED
 static void acx100_set_wepkey(acx_device_t *adev)
 {
@@ -1900,6 +1950,17 @@ void acx_update_settings(acx_device_t *adev)
 {
 	log(L_INIT, "Updating initial settings\n");
 
+	/* Whatever the fw had before, all of it is written again */
+	acx_cfg_shadow_reset(adev);
+	acx_apply_settings(adev);
+}
+
+/* Like acx_update_settings(), but trusts the IE shadow: only what the
+ * fw doesn't have yet is written */
+void acx_apply_settings(acx_device_t *adev)
+{
+	acx_cfg_begin(adev);
+
 	acx1xx_update_station_id(adev);
 
 	acx1xx_update_rate_fallback(adev);
@@ -1925,8 +1986,11 @@ void acx_update_settings(acx_device_t *adev)
 	if (IS_ACX111(adev)) {
 		acx_update_sensitivity(adev);
 		acx111_set_recalib_auto(adev, 1);
+		acx111_update_queue_prio(adev);
 	}
 
+	if (acx_cfg_commit(adev) != OK)
+		log(L_ANY, "Some initial settings failed\n");
 }
 
 
@@ -39,6 +39,7 @@ int acx1xx_update_rx(acx_device_t *adev);
 int acx1xx_update_retry(acx_device_t *adev);
 int acx1xx_update_msdu_lifetime(acx_device_t *adev);
 int acx111_set_recalib_auto(acx_device_t *adev, int enable);
+int acx111_update_queue_prio(acx_device_t *adev);
 int acx_update_hw_encryption(acx_device_t *adev);
 int acx_set_hw_encryption_on(acx_device_t *adev);
 int acx_set_hw_encryption_off(acx_device_t *adev);
@@ -52,5 +53,6 @@ int acx_set_mode(acx_device_t *adev, u16 mode);
 int acx_update_mode(acx_device_t *adev);
 void acx_set_defaults(acx_device_t *adev);
 void acx_update_settings(acx_device_t *adev);
+void acx_apply_settings(acx_device_t *adev);
 
 #endif
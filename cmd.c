@@ -18,6 +18,8 @@
 
 #include "acx_debug.h"
 
+#include <linux/ktime.h>
+
 #include "acx.h"
 #include "usb.h"
 #include "merge.h"
@@ -66,6 +68,10 @@ const struct acx_cmd_desc acx_cmd_descs[] = {
         DEF_CMD(ACX1FF_CMD_LNA_CONTROL,		0x20), /* new firmware? TNETW1450? */
         DEF_CMD(ACX1FF_CMD_CONTROL_DBG_TRACE, 	0x21), /* new firmware? TNETW1450? */
 };
+BUILD_BUG_DECL(acx_cmd_descs__VS__ACX_CMD_LAT_CMDS,
+	ARRAY_SIZE(acx_cmd_descs) > ACX_CMD_LAT_CMDS);
+BUILD_BUG_DECL(acx_ie_descs__VS__ACX_IE_SHADOW_MAX,
+	ACX100_IE_DOT11_UNKNOWN_1013 >= ACX_IE_SHADOW_MAX);
 
 const char *acx_cmd_status_str(unsigned int state)
 {
@@ -92,22 +98,46 @@ const char *acx_cmd_status_str(unsigned int state)
 	    cmd_error_strings[state] : "?";
 }
 
+static void acx_cmd_lat_account(acx_device_t *adev, enum acx_cmd cmd,
+				ktime_t start)
+{
+	unsigned long us = ktime_to_us(ktime_sub(ktime_get(), start));
+	unsigned int bucket = fls(us >> 5);
+
+	if (bucket >= ACX_CMD_LAT_BUCKETS)
+		bucket = ACX_CMD_LAT_BUCKETS - 1;
+	adev->cmd_lat_hist[cmd][bucket]++;
+	if (us > adev->cmd_lat_max_us[cmd])
+		adev->cmd_lat_max_us[cmd] = us;
+}
+
 int acx_issue_cmd_timeout(acx_device_t *adev, enum acx_cmd cmd, void *param,
 		unsigned len, unsigned timeout)
 {
 	const unsigned int cmdval = acx_cmd_descs[cmd].val;
 	const char *cmdstr = acx_cmd_descs[cmd].name;
+	ktime_t start;
+	int res;
+
+	/* Queued configures go first, to keep the order of commands */
+	if (adev->cfg_txn && cmd != ACX1xx_CMD_CONFIGURE)
+		acx_cfg_flush(adev);
 
+	start = ktime_get();
 	if (IS_PCI(adev) || IS_MEM(adev))
-		return _acx_issue_cmd_timeo_debug(adev, cmdval, param, len,
+		res = _acx_issue_cmd_timeo_debug(adev, cmdval, param, len,
 						timeout, cmdstr);
-	if (IS_USB(adev))
-		return acxusb_issue_cmd_timeo_debug(adev, cmdval, param, len,
+	else if (IS_USB(adev))
+		res = acxusb_issue_cmd_timeo_debug(adev, cmdval, param, len,
 						timeout, cmdstr);
+	else {
+		log(L_ANY, "Unsupported dev_type=%i\n", (adev)->dev_type);
+		return (NOT_OK);
+	}
 
-	log(L_ANY, "Unsupported dev_type=%i\n", (adev)->dev_type);
+	acx_cmd_lat_account(adev, cmd, start);
 
-	return (NOT_OK);
+	return res;
 }
 
 inline int acx_issue_cmd(acx_device_t *adev, enum acx_cmd cmd, void *param, unsigned len)
@@ -121,7 +151,85 @@ inline int acx_configure(acx_device_t *adev, void *pdr, enum acx_ie type)
 	return acx_configure_len(adev, pdr, type, acx_ie_descs[type].len);
 }
 
-int acx_configure_len(acx_device_t *adev, void *pdr, enum acx_ie type, u16 len)
+/*
+ * Configure transactions
+ *
+ * Between acx_cfg_begin() and acx_cfg_commit(), acx_configure_len()
+ * doesn't write to the fw right away. The value is queued in the IE's
+ * shadow instead, and written once, back to back with the other
+ * queued IEs, when the transaction is committed. Values the fw
+ * already has, or that are overwritten before the commit, are not
+ * written at all (cfg_cmds_saved).
+ *
+ * Any other command, interrogates included, flushes the queue first,
+ * so the fw sees commands in the order they were issued.
+ *
+ * The shadow is only trusted between fw resets, see
+ * acx_cfg_shadow_reset().
+ */
+void acx_cfg_shadow_reset(acx_device_t *adev)
+{
+	memset(adev->ie_shadow, 0, sizeof(adev->ie_shadow));
+	adev->cfg_txn_queued = 0;
+}
+
+void acx_cfg_begin(acx_device_t *adev)
+{
+	if (!adev->cfg_txn++)
+		adev->cfg_txn_res = OK;
+}
+
+static int acx_configure_issue(acx_device_t *adev, void *pdr,
+			enum acx_ie type, u16 len);
+
+int acx_cfg_flush(acx_device_t *adev)
+{
+	u8 buf[4 + ACX_IE_SHADOW_LEN];
+	struct acx_ie_shadow *sh;
+	int i, res = OK;
+
+	for (i = 0; i < adev->cfg_txn_queued; i++) {
+		sh = &adev->ie_shadow[adev->cfg_txn_queue[i]];
+
+		memcpy(&buf[4], sh->data, sh->len);
+		sh->dirty = 0;
+		sh->valid = (acx_configure_issue(adev, buf,
+				adev->cfg_txn_queue[i], sh->len) == OK);
+		if (!sh->valid)
+			res = NOT_OK;
+	}
+	adev->cfg_txn_queued = 0;
+
+	if (res != OK)
+		adev->cfg_txn_res = NOT_OK;
+
+	return res;
+}
+
+/*
+ * Returns NOT_OK if any configure of the transaction failed. Inside a
+ * transaction, acx_configure_len() returns OK for queued values, so
+ * this is the only place a rejected value shows up.
+ */
+int acx_cfg_commit(acx_device_t *adev)
+{
+	if (WARN_ON(!adev->cfg_txn))
+		return NOT_OK;
+
+	if (--adev->cfg_txn)
+		return OK;
+
+	acx_cfg_flush(adev);
+
+	if (adev->cfg_txn_res != OK)
+		log(L_ANY, "%s: configure transaction failed\n",
+			wiphy_name(adev->hw->wiphy));
+
+	return adev->cfg_txn_res;
+}
+
+static int acx_configure_issue(acx_device_t *adev, void *pdr,
+			enum acx_ie type, u16 len)
 {
 	int res;
 	char msgbuf[255];
@@ -144,9 +252,79 @@ int acx_configure_len(acx_device_t *adev, void *pdr, enum acx_ie type, u16 len)
 	 else
 		log(L_ANY,  "%s: FAILED\n", msgbuf);
 
+	adev->cfg_cmds_written++;
+
 	return res;
 }
 
+int acx_configure_len(acx_device_t *adev, void *pdr, enum acx_ie type, u16 len)
+{
+	struct acx_ie_shadow *sh;
+	const u8 *data = (u8 *) pdr + 4;
+	int res;
+
+	if (type >= ACX_IE_SHADOW_MAX || len > ACX_IE_SHADOW_LEN) {
+		if (adev->cfg_txn)
+			acx_cfg_flush(adev);
+		return acx_configure_issue(adev, pdr, type, len);
+	}
+	sh = &adev->ie_shadow[type];
+
+	sh->cached = 0;
+	sh->configured = 1;
+	sh->seq = ++adev->cfg_seq;
+
+	if (!adev->cfg_txn) {
+		res = acx_configure_issue(adev, pdr, type, len);
+		sh->valid = (res == OK);
+		sh->len = len;
+		memcpy(sh->data, data, len);
+		return res;
+	}
+
+	if ((sh->valid || sh->dirty) && sh->len == len
+		&& !memcmp(sh->data, data, len)) {
+		log(L_DEBUG, "%s: unchanged, skipped\n",
+			acx_ie_descs[type].name);
+		adev->cfg_cmds_saved++;
+		return OK;
+	}
+
+	if (sh->dirty)
+		/* Overwrites the queued value */
+		adev->cfg_cmds_saved++;
+	else
+		adev->cfg_txn_queue[adev->cfg_txn_queued++] = type;
+
+	sh->valid = 0;
+	sh->dirty = 1;
+	sh->len = len;
+	memcpy(sh->data, data, len);
+
+	return OK;
+}
+
+static void acx_ie_cache_store(acx_device_t *adev, const void *pdr,
+			enum acx_ie type, u16 len)
+{
+	struct acx_ie_shadow *sh;
+
+	if (type >= ACX_IE_SHADOW_MAX || len > ACX_IE_SHADOW_LEN)
+		return;
+
+	/* Queued configures were flushed by acx_issue_cmd() */
+	sh = &adev->ie_shadow[type];
+	if (!sh->configured) {
+		adev->ie_default[type].valid = 1;
+		adev->ie_default[type].len = len;
+		memcpy(adev->ie_default[type].data, (const u8 *) pdr + 4, len);
+	}
+	sh->valid = 1;
+	sh->cached = 1;
+	sh->len = len;
+	memcpy(sh->data, (const u8 *) pdr + 4, len);
+}
+
 int acx_interrogate(acx_device_t *adev, void *pdr, enum acx_ie type)
 {
 	int res;
@@ -166,7 +344,9 @@ int acx_interrogate(acx_device_t *adev, void *pdr, enum acx_ie type)
 	((acx_ie_generic_t *) pdr)->type = cpu_to_le16(typeval);
 	((acx_ie_generic_t *) pdr)->len = cpu_to_le16(len);
 	res = acx_issue_cmd(adev, ACX1xx_CMD_INTERROGATE, pdr, len + 4);
-	if (unlikely(OK != res)) {
+	if (likely(OK == res))
+		acx_ie_cache_store(adev, pdr, type, len);
+	else {
 #if ACX_DEBUG
 		pr_info("%s: (type:%s) FAILED\n",
 			wiphy_name(adev->hw->wiphy), typestr);
@@ -180,6 +360,113 @@ int acx_interrogate(acx_device_t *adev, void *pdr, enum acx_ie type)
 	return res;
 }
 
+/*
+ * Like acx_interrogate(), but served from the IE shadow, if the value
+ * was interrogated before and nothing was configured since. For
+ * settings only the driver changes (antenna, tx level, ...), not for
+ * counters or status. The shadow is reset with the fw, see
+ * acx_cfg_shadow_reset(). Use acx_interrogate() to force a refresh.
+ */
+int acx_interrogate_cached(acx_device_t *adev, void *pdr, enum acx_ie type)
+{
+	const u16 len = acx_ie_descs[type].len;
+	struct acx_ie_shadow *sh;
+
+	if (type < ACX_IE_SHADOW_MAX && len <= ACX_IE_SHADOW_LEN) {
+		sh = &adev->ie_shadow[type];
+		if (sh->cached && sh->len == len) {
+			((acx_ie_generic_t *) pdr)->type =
+				cpu_to_le16(acx_ie_descs[type].val);
+			((acx_ie_generic_t *) pdr)->len = cpu_to_le16(len);
+			memcpy((u8 *) pdr + 4, sh->data, len);
+			adev->ie_cache_hits++;
+			return OK;
+		}
+	}
+
+	return acx_interrogate(adev, pdr, type);
+}
+
+/*
+ * Settings snapshot for resume
+ *
+ * acx_cfg_snapshot() saves the IEs we configured, as the fw has them,
+ * in the order they were last configured. After the fw reset on
+ * resume, acx_cfg_replay() writes them back in one transaction. IEs
+ * whose fw default is known (interrogated before we configured them)
+ * are seeded into the shadow first, so the transaction skips the ones
+ * we left at their default, as well as what init_mac already set.
+ */
+void acx_cfg_snapshot(acx_device_t *adev)
+{
+	struct acx_ie_shadow *sh;
+	struct acx_ie_snap tmp;
+	int i, j, n = 0;
+
+	if (adev->cfg_txn_queued)
+		acx_cfg_flush(adev);
+
+	for (i = 0; i < ACX_IE_SHADOW_MAX; i++) {
+		sh = &adev->ie_shadow[i];
+		if (!sh->valid || !sh->configured)
+			continue;
+
+		adev->resume_snap[n].type = i;
+		adev->resume_snap[n].len = sh->len;
+		adev->resume_snap[n].seq = sh->seq;
+		memcpy(adev->resume_snap[n].data, sh->data, sh->len);
+
+		/* keep them sorted by seq */
+		for (j = n++; j && adev->resume_snap[j - 1].seq
+				> adev->resume_snap[j].seq; j--) {
+			tmp = adev->resume_snap[j];
+			adev->resume_snap[j] = adev->resume_snap[j - 1];
+			adev->resume_snap[j - 1] = tmp;
+		}
+	}
+	adev->resume_snap_cnt = n;
+
+	log(L_INIT, "settings snapshot: %d IEs\n", n);
+}
+
+void acx_cfg_replay(acx_device_t *adev)
+{
+	u8 buf[4 + ACX_IE_SHADOW_LEN];
+	struct acx_ie_shadow *sh, *def;
+	struct acx_ie_snap *snap;
+	unsigned long written = adev->cfg_cmds_written;
+	unsigned long saved = adev->cfg_cmds_saved;
+	int i;
+
+	for (i = 0; i < adev->resume_snap_cnt; i++) {
+		snap = &adev->resume_snap[i];
+		sh = &adev->ie_shadow[snap->type];
+		def = &adev->ie_default[snap->type];
+		if (sh->valid || sh->dirty || !def->valid)
+			continue;
+		sh->valid = 1;
+		sh->len = def->len;
+		memcpy(sh->data, def->data, def->len);
+	}
+
+	acx_cfg_begin(adev);
+	for (i = 0; i < adev->resume_snap_cnt; i++) {
+		snap = &adev->resume_snap[i];
+		memcpy(&buf[4], snap->data, snap->len);
+		acx_configure_len(adev, buf, snap->type, snap->len);
+	}
+	/* Failed IEs stay invalid in the shadow, acx_op_start() retries
+	 * them */
+	if (acx_cfg_commit(adev) != OK)
+		log(L_ANY, "settings replay: some IEs failed\n");
+
+	adev->resume_written = adev->cfg_cmds_written - written;
+	adev->resume_skipped = adev->cfg_cmds_saved - saved;
+
+	log(L_INIT, "settings replay: %u IEs written, %u skipped\n",
+		adev->resume_written, adev->resume_skipped);
+}
+
 /* Looks scary, eh?
 ** Actually, each one compiled into one AND and one SHIFT,
 ** 31 bytes in x86 asm (more if uints are replaced by u16/u8) */
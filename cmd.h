@@ -57,6 +57,14 @@ int acx_configure(acx_device_t *adev, void *pdr, enum acx_ie type);
 int acx_configure_len(acx_device_t *adev, void *pdr, enum acx_ie type, u16 len);
 
 int acx_interrogate(acx_device_t *adev, void *pdr, enum acx_ie type);
+int acx_interrogate_cached(acx_device_t *adev, void *pdr, enum acx_ie type);
+
+void acx_cfg_shadow_reset(acx_device_t *adev);
+void acx_cfg_begin(acx_device_t *adev);
+int acx_cfg_flush(acx_device_t *adev);
+int acx_cfg_commit(acx_device_t *adev);
+void acx_cfg_snapshot(acx_device_t *adev);
+void acx_cfg_replay(acx_device_t *adev);
 
 int acx_cmd_join_bssid(acx_device_t *adev, const u8 *bssid);
 int acx_cmd_scan(acx_device_t *adev);
@@ -151,6 +151,80 @@ unsigned int acx_watchdog_enable = 0;
 module_param_named(watchdog, acx_watchdog_enable, uint, 0644);
 MODULE_PARM_DESC(debug, "Enable watchdog");
 
+int acx_tx_batch = ACX_TX_BATCH_AUTO;
+module_param_named(txbatch, acx_tx_batch, int, 0644);
+MODULE_PARM_DESC(txbatch, "Max tx frames per doorbell (0,1: one per frame, "
+		"-1: tx ring size)");
+
+unsigned int acx_tx_stop_queue = TX_STOP_QUEUE;
+module_param_named(txstop, acx_tx_stop_queue, uint, 0644);
+MODULE_PARM_DESC(txstop, "Stop a tx queue below this many free descs");
+
+unsigned int acx_tx_start_queue = TX_START_QUEUE;
+module_param_named(txstart, acx_tx_start_queue, uint, 0644);
+MODULE_PARM_DESC(txstart, "Wake a stopped tx queue at this many free descs "
+		"(>= txstop)");
+
+unsigned int acx_rx_descs = RX_CNT;
+module_param_named(rxdescs, acx_rx_descs, uint, 0444);
+MODULE_PARM_DESC(rxdescs, "PCI/MEM: rx ring size (power of two, 8-64)");
+
+unsigned int acx_tx_descs = TX_CNT;
+module_param_named(txdescs, acx_tx_descs, uint, 0444);
+MODULE_PARM_DESC(txdescs, "PCI/MEM: tx ring size per queue "
+		"(power of two, 8-64)");
+
+unsigned int acx_mem_block_size;
+module_param_named(memblocksize, acx_mem_block_size, uint, 0444);
+MODULE_PARM_DESC(memblocksize, "PCI/MEM: acx memory block size "
+		"(128, 256, 512; 0: default)");
+
+int acx_mem_split = ACX100_MEM_SPLIT_DEFAULT;
+module_param_named(memsplit, acx_mem_split, int, 0644);
+MODULE_PARM_DESC(memsplit, "ACX100: percent of the memory pool for tx "
+		"(20-80, -1: auto)");
+
+unsigned int acx_tx_zerocopy = 1;
+module_param_named(txzerocopy, acx_tx_zerocopy, uint, 0644);
+MODULE_PARM_DESC(txzerocopy, "PCI: DMA tx frames directly from the skb");
+
+unsigned int acx_rx_zerocopy = 1;
+module_param_named(rxzerocopy, acx_rx_zerocopy, uint, 0444);
+MODULE_PARM_DESC(rxzerocopy, "PCI: receive into DMA-mapped skbs, no copy");
+
+int acx_rx_budget = ACX_RX_BUDGET_AUTO;
+module_param_named(rxbudget, acx_rx_budget, int, 0644);
+MODULE_PARM_DESC(rxbudget, "PCI/MEM: max rx frames per irq pass (0: no limit, "
+		"-1: half the rx ring)");
+
+unsigned int acx_irq_iterate;
+module_param_named(irqiterate, acx_irq_iterate, uint, 0644);
+MODULE_PARM_DESC(irqiterate, "PCI/MEM: extra irq passes, sending tx "
+		"inline (0-16, 0: one pass)");
+
+unsigned int acx_fw_fast = 1;
+module_param_named(fwfast, acx_fw_fast, uint, 0644);
+MODULE_PARM_DESC(fwfast, "PCI/MEM: stream the firmware in auto-increment "
+		"mode and verify it in one pass (retries go word by word)");
+
+int acx_rx_coalesce = ACX_RX_COAL_ADAPTIVE;
+module_param_named(rxcoalesce, acx_rx_coalesce, int, 0444);
+MODULE_PARM_DESC(rxcoalesce, "PCI/MEM: rx irq rearm delay in usecs "
+		"(-1: adaptive, 0: off)");
+
+unsigned int acx_usb_tx_urbs = ACX_TX_URB_CNT;
+module_param_named(txurbs, acx_usb_tx_urbs, uint, 0444);
+MODULE_PARM_DESC(txurbs, "USB: tx urbs in flight (5-32)");
+
+unsigned int acx_usb_rx_urbs = ACX_RX_URB_CNT;
+module_param_named(rxurbs, acx_usb_rx_urbs, uint, 0444);
+MODULE_PARM_DESC(rxurbs, "USB: rx urbs in flight (2-16)");
+
+unsigned int acx_usb_tx_agg;
+module_param_named(txagg, acx_usb_tx_agg, uint, 0644);
+MODULE_PARM_DESC(txagg, "USB: max frames packed into one bulk-out urb "
+		"(0/1: off, experimental)");
+
 #if ACX_DEBUG
 
 /* will add __read_mostly later */
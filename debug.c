@@ -37,10 +37,14 @@
 #include "main.h"
 #include "boot.h"
 #include "debug.h"
+#include "tx.h"
 
 enum file_index {
 	INFO, DIAG, EEPROM, PHY, DEBUG,
 	SENSITIVITY, TX_LEVEL, ANTENNA, REG_DOMAIN,
+	TX_BATCH, RX_POLL, MEM_BENCH, STATS, CMD_LAT,
+	RX_COALESCE, TX_FLOW, MEM_SPLIT, TXBUF, IRQ_ITER,
+	BOOT,
 };
 static const char *const dbgfs_files[] = {
 	[INFO]		= "info",
@@ -52,9 +56,20 @@ static const char *const dbgfs_files[] = {
 	[TX_LEVEL]	= "tx_level",
 	[ANTENNA]	= "antenna",
 	[REG_DOMAIN]	= "reg_domain",
+	[TX_BATCH]	= "tx_batch",
+	[RX_POLL]	= "rx_poll",
+	[MEM_BENCH]	= "mem_bench",
+	[STATS]		= "stats",
+	[CMD_LAT]	= "cmd_lat",
+	[RX_COALESCE]	= "rx_coalesce",
+	[TX_FLOW]	= "tx_flow",
+	[MEM_SPLIT]	= "mem_split",
+	[TXBUF]		= "txbuf",
+	[IRQ_ITER]	= "irq_iter",
+	[BOOT]		= "boot",
 };
-BUILD_BUG_DECL(dbgfs_files__VS__enum_REG_DOMAIN,
-	ARRAY_SIZE(dbgfs_files) != REG_DOMAIN + 1);
+BUILD_BUG_DECL(dbgfs_files__VS__enum_BOOT,
+	ARRAY_SIZE(dbgfs_files) != BOOT + 1);
 
 static struct dentry *acx_dbgfs_dir;
 
@@ -109,7 +124,11 @@ static int acx_dbgfs_show_diag(struct seq_file *file, void *v)
 	seq_printf(file, "dev_addr  " MACSTR "\n", MAC(adev->dev_addr));
 	seq_printf(file, "bssid     " MACSTR "\n", MAC(adev->bssid));
 
-	seq_printf(file, "tx_queue len: %d\n", skb_queue_len(&adev->tx_queue));
+	seq_printf(file, "tx_queue len: %d %d %d %d\n",
+		skb_queue_len(&adev->tx_queue[0]),
+		skb_queue_len(&adev->tx_queue[1]),
+		skb_queue_len(&adev->tx_queue[2]),
+		skb_queue_len(&adev->tx_queue[3]));
 
 	seq_printf(file, "\n" "** PHY status **\n"
 		"tx_enabled %d, tx_level_dbm %d, tx_level_val %d,\n "
@@ -798,6 +817,452 @@ out:
 	return ret;
 }
 
+static int acx_dbgfs_show_tx_batch(struct seq_file *file, void *v)
+{
+	acx_device_t *adev = (acx_device_t *) file->private;
+	unsigned long frames = 0;
+	int i;
+
+	acx_sem_lock(adev);
+
+	seq_printf(file, "txbatch: %u, doorbells: %lu\n",
+		acx_tx_batch_limit(adev), adev->tx_doorbells);
+	for (i = 0; i < ACX_TX_BATCH_HIST_LEN; i++) {
+		frames += (i + 1) * adev->tx_batch_hist[i];
+		seq_printf(file, "%2d%s: %lu\n", i + 1,
+			(i == ACX_TX_BATCH_HIST_LEN - 1) ? "+" : " ",
+			adev->tx_batch_hist[i]);
+	}
+	if (adev->tx_doorbells)
+		seq_printf(file, "frames/doorbell: %lu.%02lu\n",
+			frames / adev->tx_doorbells,
+			(frames * 100 / adev->tx_doorbells) % 100);
+
+	acx_sem_unlock(adev);
+
+	return 0;
+}
+
+/* Writing anything to tx_batch clears the histogram */
+static ssize_t acx_dbgfs_write_tx_batch(acx_device_t *adev, struct file *file,
+					const char __user *ubuf, size_t count, loff_t *ppos)
+{
+	acx_sem_lock(adev);
+
+	adev->tx_doorbells = 0;
+	memset(adev->tx_batch_hist, 0, sizeof(adev->tx_batch_hist));
+
+	acx_sem_unlock(adev);
+
+	return count;
+}
+
+static int acx_dbgfs_show_rx_poll(struct seq_file *file, void *v)
+{
+	acx_device_t *adev = (acx_device_t *) file->private;
+
+	acx_sem_lock(adev);
+
+	seq_printf(file, "rxbudget: %u\n"
+		"polls: %lu\n"
+		"frames: %lu\n"
+		"budget exhausted: %lu\n"
+		"irq re-arms: %lu\n",
+		acx_rx_budget_limit(adev), adev->rx_polls, adev->rx_poll_frames,
+		adev->rx_budget_exhausted, adev->irq_rearms);
+	if (adev->rx_polls)
+		seq_printf(file, "frames/poll: %lu.%02lu\n",
+			adev->rx_poll_frames / adev->rx_polls,
+			(adev->rx_poll_frames * 100 / adev->rx_polls) % 100);
+
+	acx_sem_unlock(adev);
+
+	return 0;
+}
+
+/* Writing anything to rx_poll clears the counters */
+static ssize_t acx_dbgfs_write_rx_poll(acx_device_t *adev, struct file *file,
+					const char __user *ubuf, size_t count, loff_t *ppos)
+{
+	acx_sem_lock(adev);
+
+	adev->rx_polls = 0;
+	adev->rx_poll_frames = 0;
+	adev->rx_budget_exhausted = 0;
+	adev->irq_rearms = 0;
+
+	acx_sem_unlock(adev);
+
+	return count;
+}
+
+/* Reading mem_bench runs the slave memory copy benchmark (MEM only) */
+static int acx_dbgfs_show_mem_bench(struct seq_file *file, void *v)
+{
+	acx_device_t *adev = (acx_device_t *) file->private;
+	int ret = 0;
+
+	acx_sem_lock(adev);
+
+	if (IS_MEM(adev))
+		ret = acxmem_dbgfs_bench_output(file, adev);
+	else
+		seq_printf(file, "not a slave memory device\n");
+
+	acx_sem_unlock(adev);
+
+	return ret;
+}
+
+static int acx_dbgfs_show_stats(struct seq_file *file, void *v)
+{
+	acx_device_t *adev = (acx_device_t *) file->private;
+	struct ieee80211_supported_band *sband;
+	struct acx_stats_counters sum;
+	int i;
+
+	acx_sem_lock(adev);
+
+	acx_stats_fold(adev, &sum);
+
+	seq_printf(file, "rx: %llu packets, %llu bytes, %lu errors\n"
+		"tx: %llu packets, %llu bytes, %lu errors "
+		"(%lu aborted, %lu fifo)\n",
+		sum.rx_packets, sum.rx_bytes, adev->stats.rx_errors,
+		sum.tx_packets, sum.tx_bytes, adev->stats.tx_errors,
+		adev->stats.tx_aborted_errors, adev->stats.tx_fifo_errors);
+
+	seq_printf(file, "tx per queue:\n");
+	for (i = 0; i < ACX111_MAX_NUM_HW_TX_QUEUES; i++)
+		seq_printf(file, "%d: %llu\n", i, sum.tx_queue_packets[i]);
+
+	/* rate idx as given by mac80211, for the band in use */
+	sband = adev->hw->wiphy->bands[adev->rx_status.band];
+	seq_printf(file, "tx per rate:\n");
+	for (i = 0; i < ACX_STATS_RATES; i++) {
+		if (!sum.tx_rate_packets[i])
+			continue;
+		if (sband && i < sband->n_bitrates)
+			seq_printf(file, "%2d (%3d.%d Mbps): %llu\n", i,
+				sband->bitrates[i].bitrate / 10,
+				sband->bitrates[i].bitrate % 10,
+				sum.tx_rate_packets[i]);
+		else
+			seq_printf(file, "%2d: %llu\n", i,
+				sum.tx_rate_packets[i]);
+	}
+
+#ifdef CONFIG_ACX_MAC80211_USB
+	if (IS_USB(adev))
+		seq_printf(file, "usb rx urbs: %u, in flight %d, "
+			"starved %lu, misordered %lu, lost %lu\n",
+			adev->usb_rx_cnt, atomic_read(&adev->usb_rx_inflight),
+			adev->usb_rx_starved, adev->usb_rx_misordered,
+			adev->usb_rx_lost);
+#endif
+
+	acx_sem_unlock(adev);
+
+	return 0;
+}
+
+/* Fw command latencies: one line per command issued, the buckets are
+ * <32us, <64us, ... <32ms, and >=32ms. Plus the configure commands
+ * saved by configure transactions, see acx_cfg_begin() */
+static int acx_dbgfs_show_cmd_lat(struct seq_file *file, void *v)
+{
+	acx_device_t *adev = (acx_device_t *) file->private;
+	unsigned long total;
+	int i, b;
+
+	acx_sem_lock(adev);
+
+	seq_printf(file, "%-32s %6s", "cmd", "max_us");
+	for (b = 0; b < ACX_CMD_LAT_BUCKETS - 1; b++)
+		seq_printf(file, " <%uus", 32U << b);
+	seq_printf(file, " more\n");
+
+	for (i = 0; i <= ACX1FF_CMD_CONTROL_DBG_TRACE; i++) {
+		total = 0;
+		for (b = 0; b < ACX_CMD_LAT_BUCKETS; b++)
+			total += adev->cmd_lat_hist[i][b];
+		if (!total)
+			continue;
+
+		seq_printf(file, "%-32s %6lu", acx_cmd_descs[i].name,
+			adev->cmd_lat_max_us[i]);
+		for (b = 0; b < ACX_CMD_LAT_BUCKETS; b++)
+			seq_printf(file, " %lu", adev->cmd_lat_hist[i][b]);
+		seq_printf(file, "\n");
+	}
+
+	seq_printf(file, "configure: written %lu, saved %lu\n"
+		"interrogate: served from cache %lu\n",
+		adev->cfg_cmds_written, adev->cfg_cmds_saved,
+		adev->ie_cache_hits);
+
+	acx_sem_unlock(adev);
+
+	return 0;
+}
+
+/* Writing anything to cmd_lat clears the histogram and counters */
+static ssize_t acx_dbgfs_write_cmd_lat(acx_device_t *adev, struct file *file,
+					const char __user *ubuf, size_t count, loff_t *ppos)
+{
+	acx_sem_lock(adev);
+
+	memset(adev->cmd_lat_hist, 0, sizeof(adev->cmd_lat_hist));
+	memset(adev->cmd_lat_max_us, 0, sizeof(adev->cmd_lat_max_us));
+	adev->cfg_cmds_written = 0;
+	adev->cfg_cmds_saved = 0;
+	adev->ie_cache_hits = 0;
+
+	acx_sem_unlock(adev);
+
+	return count;
+}
+
+static int acx_dbgfs_show_rx_coalesce(struct seq_file *file, void *v)
+{
+	acx_device_t *adev = (acx_device_t *) file->private;
+
+	acx_sem_lock(adev);
+
+	if (adev->rx_coal_mode == ACX_RX_COAL_ADAPTIVE)
+		seq_printf(file, "mode: adaptive\n");
+	else
+		seq_printf(file, "mode: fixed %d us\n", adev->rx_coal_mode);
+	seq_printf(file, "rx rearm delay: %u us\n"
+		"delayed rearms: %lu\n"
+		"rx frames/s: %u\n"
+		"irqs/s: %u\n",
+		adev->rx_coal_usecs, adev->rx_coal_delays,
+		adev->rx_rate, adev->irq_rate);
+
+	acx_sem_unlock(adev);
+
+	return 0;
+}
+
+/* Write a delay in usecs (0: off), or -1 for adaptive */
+static ssize_t acx_dbgfs_write_rx_coalesce(acx_device_t *adev,
+					struct file *file, const char __user *ubuf,
+					size_t count, loff_t *ppos)
+{
+	int val, ret;
+
+	ret = kstrtoint_from_user(ubuf, count, 0, &val);
+	if (ret)
+		return ret;
+	if (val < ACX_RX_COAL_ADAPTIVE || val > ACX_RX_COAL_MAX_USECS)
+		return -EINVAL;
+
+	acx_sem_lock(adev);
+
+	adev->rx_coal_mode = val;
+	if (val != ACX_RX_COAL_ADAPTIVE)
+		adev->rx_coal_usecs = val;
+
+	acx_sem_unlock(adev);
+
+	return count;
+}
+
+static int acx_dbgfs_show_tx_flow(struct seq_file *file, void *v)
+{
+	acx_device_t *adev = (acx_device_t *) file->private;
+	struct hw_tx_queue *hwq;
+	int i;
+
+	acx_sem_lock(adev);
+
+	seq_printf(file, "txstop: %u, txstart: %u\n",
+		acx_tx_stop_queue, acx_tx_start_queue);
+	seq_printf(file, "queue free stopped_acs stops wakes\n");
+	for (i = 0; i < adev->num_hw_tx_queues; i++) {
+		hwq = &adev->hw_tx_queue[i];
+		seq_printf(file, "%5d %4u 0x%02lx %u %u\n", i,
+			acx_tx_queue_free(adev, i), hwq->stopped_acs,
+			atomic_read(&hwq->stops), atomic_read(&hwq->wakes));
+	}
+
+	if (IS_MEM(adev) && adev->txclean_descs)
+		seq_printf(file, "txdesc clean: %lu descs, %lu mmio accesses, "
+			"%lu per desc\n", adev->txclean_descs,
+			adev->txclean_mmio,
+			adev->txclean_mmio / adev->txclean_descs);
+
+	acx_sem_unlock(adev);
+
+	return 0;
+}
+
+/* Writing anything to tx_flow clears the counters */
+static ssize_t acx_dbgfs_write_tx_flow(acx_device_t *adev, struct file *file,
+				const char __user *ubuf, size_t count, loff_t *ppos)
+{
+	int i;
+
+	acx_sem_lock(adev);
+
+	for (i = 0; i < ACX111_MAX_NUM_HW_TX_QUEUES; i++) {
+		atomic_set(&adev->hw_tx_queue[i].stops, 0);
+		atomic_set(&adev->hw_tx_queue[i].wakes, 0);
+	}
+	adev->txclean_descs = 0;
+	adev->txclean_mmio = 0;
+
+	acx_sem_unlock(adev);
+
+	return count;
+}
+
+static int acx_dbgfs_show_mem_split(struct seq_file *file, void *v)
+{
+	acx_device_t *adev = (acx_device_t *) file->private;
+
+	acx_sem_lock(adev);
+
+	seq_printf(file, "memblocksize: %u\n", adev->memblocksize);
+	if (!IS_ACX100(adev)) {
+		seq_printf(file, "tx/rx split: by fw (acx111)\n");
+		goto out;
+	}
+
+	if (acx_mem_split == ACX100_MEM_SPLIT_AUTO)
+		seq_printf(file, "memsplit: auto\n");
+	else
+		seq_printf(file, "memsplit: %d%%\n", acx_mem_split);
+	seq_printf(file, "tx: %u%%, %u blocks\n"
+		"rx: %u%%, %u blocks\n"
+		"tx starved: %lu (%lu since split)\n"
+		"rx ring full: %lu (%lu since split)\n",
+		adev->mem_tx_pct, adev->mem_tx_blocks,
+		100 - adev->mem_tx_pct, adev->mem_rx_blocks,
+		adev->mem_tx_starved,
+		adev->mem_tx_starved - adev->mem_tx_starved_last,
+		adev->mem_rx_full,
+		adev->mem_rx_full - adev->mem_rx_full_last);
+out:
+	acx_sem_unlock(adev);
+
+	return 0;
+}
+
+static int acx_dbgfs_show_txbuf(struct seq_file *file, void *v)
+{
+	acx_device_t *adev = (acx_device_t *) file->private;
+	int ret = 0;
+
+	acx_sem_lock(adev);
+
+	if (IS_MEM(adev))
+		ret = acxmem_dbgfs_txbuf_output(file, adev);
+	else
+		seq_printf(file, "not a slave memory device\n");
+
+	acx_sem_unlock(adev);
+
+	return ret;
+}
+
+static int acx_dbgfs_show_irq_iter(struct seq_file *file, void *v)
+{
+	acx_device_t *adev = (acx_device_t *) file->private;
+	unsigned long passes = 0;
+	int i;
+
+	acx_sem_lock(adev);
+
+	seq_printf(file, "irqiterate: %u, irq works: %lu\n",
+		acx_irq_iterate, adev->irq_works);
+	for (i = 0; i <= ACX_IRQ_ITERATE_MAX; i++) {
+		passes += (i + 1) * adev->irq_passes[i];
+		if (adev->irq_passes[i])
+			seq_printf(file, "%2d passes: %lu\n", i + 1,
+				adev->irq_passes[i]);
+	}
+	if (adev->irq_works)
+		seq_printf(file, "passes/work: %lu.%02lu\n"
+			"time/work: %llu ns, max %llu ns\n",
+			passes / adev->irq_works,
+			(passes * 100 / adev->irq_works) % 100,
+			div64_u64(adev->irq_work_ns, adev->irq_works),
+			adev->irq_work_max_ns);
+
+	acx_sem_unlock(adev);
+
+	return 0;
+}
+
+/* Writing anything to irq_iter clears the counters */
+static ssize_t acx_dbgfs_write_irq_iter(acx_device_t *adev, struct file *file,
+				const char __user *ubuf, size_t count, loff_t *ppos)
+{
+	acx_sem_lock(adev);
+
+	adev->irq_works = 0;
+	memset(adev->irq_passes, 0, sizeof(adev->irq_passes));
+	adev->irq_work_ns = 0;
+	adev->irq_work_max_ns = 0;
+
+	acx_sem_unlock(adev);
+
+	return count;
+}
+
+static const char *const acx_boot_phase_names[] = {
+	[ACX_BOOT_FW_WRITE]	= "fw write",
+	[ACX_BOOT_FW_VERIFY]	= "fw verify",
+	[ACX_BOOT_ECPU]		= "ecpu start",
+	[ACX_BOOT_RADIO]	= "radio",
+	[ACX_BOOT_INIT_MAC]	= "init mac",
+};
+BUILD_BUG_DECL(acx_boot_phase_names__VS__enum_ACX_BOOT_PHASES,
+	ARRAY_SIZE(acx_boot_phase_names) != ACX_BOOT_PHASES);
+
+static const char *const acx_resume_phase_names[] = {
+	[ACX_RESUME_RESET]	= "reset",
+	[ACX_RESUME_REPLAY]	= "replay",
+	[ACX_RESUME_REGISTER]	= "register",
+	[ACX_RESUME_TOTAL]	= "total",
+};
+BUILD_BUG_DECL(acx_resume_phase_names__VS__enum_ACX_RESUME_PHASES,
+	ARRAY_SIZE(acx_resume_phase_names) != ACX_RESUME_PHASES);
+
+static int acx_dbgfs_show_boot(struct seq_file *file, void *v)
+{
+	acx_device_t *adev = (acx_device_t *) file->private;
+	int i;
+
+	acx_sem_lock(adev);
+
+	seq_printf(file, "fwfast: %u\n", acx_fw_fast);
+	if (adev->fw_tries)
+		seq_printf(file, "last fw upload: %s, %u tries\n",
+			adev->fw_fast ? "fast" : "word by word",
+			adev->fw_tries);
+	for (i = 0; i < ACX_BOOT_PHASES; i++)
+		seq_printf(file, "%-10s %8llu us\n", acx_boot_phase_names[i],
+			div_u64(adev->boot_ns[i], NSEC_PER_USEC));
+
+	seq_printf(file, "resumes: %u, snapshot: %u IEs\n",
+		adev->resumes, adev->resume_snap_cnt);
+	if (adev->resumes) {
+		seq_printf(file, "last replay: %u written, %u skipped\n",
+			adev->resume_written, adev->resume_skipped);
+		for (i = 0; i < ACX_RESUME_PHASES; i++)
+			seq_printf(file, "resume %-10s %8llu us\n",
+				acx_resume_phase_names[i],
+				div_u64(adev->resume_ns[i], NSEC_PER_USEC));
+	}
+
+	acx_sem_unlock(adev);
+
+	return 0;
+}
+
 static acx_dbgfs_show_t *const acx_dbgfs_show_funcs[] = {
 	acx_dbgfs_show_acx,
 	acx_dbgfs_show_diag,
@@ -808,6 +1273,17 @@ static acx_dbgfs_show_t *const acx_dbgfs_show_funcs[] = {
 	acx_dbgfs_show_tx_level,
 	acx_dbgfs_show_antenna,
 	acx_dbgfs_show_reg_domain,
+	acx_dbgfs_show_tx_batch,
+	acx_dbgfs_show_rx_poll,
+	acx_dbgfs_show_mem_bench,
+	acx_dbgfs_show_stats,
+	acx_dbgfs_show_cmd_lat,
+	acx_dbgfs_show_rx_coalesce,
+	acx_dbgfs_show_tx_flow,
+	acx_dbgfs_show_mem_split,
+	acx_dbgfs_show_txbuf,
+	acx_dbgfs_show_irq_iter,
+	acx_dbgfs_show_boot,
 };
 
 static acx_dbgfs_write_t *const acx_dbgfs_write_funcs[] = {
@@ -820,6 +1296,17 @@ static acx_dbgfs_write_t *const acx_dbgfs_write_funcs[] = {
 	acx_dbgfs_write_tx_level,
 	acx_dbgfs_write_antenna,
 	acx_dbgfs_write_reg_domain,
+	acx_dbgfs_write_tx_batch,
+	acx_dbgfs_write_rx_poll,
+	NULL,
+	NULL,
+	acx_dbgfs_write_cmd_lat,
+	acx_dbgfs_write_rx_coalesce,
+	acx_dbgfs_write_tx_flow,
+	NULL,
+	NULL,
+	acx_dbgfs_write_irq_iter,
+	NULL,
 };
 BUILD_BUG_DECL(acx_proc_show_funcs__VS__acx_proc_write_funcs,
 	ARRAY_SIZE(acx_dbgfs_show_funcs) != ARRAY_SIZE(acx_dbgfs_write_funcs));
@@ -840,6 +1327,17 @@ static int acx_dbgfs_open(struct inode *inode, struct file *file)
 	case TX_LEVEL:
 	case ANTENNA:
 	case REG_DOMAIN:
+	case TX_BATCH:
+	case RX_POLL:
+	case MEM_BENCH:
+	case STATS:
+	case CMD_LAT:
+	case RX_COALESCE:
+	case TX_FLOW:
+	case MEM_SPLIT:
+	case TXBUF:
+	case IRQ_ITER:
+	case BOOT:
 		pr_devel("opening filename=%s fmode=%o fidx=%d adev=%p\n",
 			dbgfs_files[fidx], file->f_mode, (int)fidx, adev);
 		break;
@@ -869,6 +1367,17 @@ static ssize_t acx_dbgfs_write(struct file *file, const char __user *buf,
 	case TX_LEVEL:
 	case ANTENNA:
 	case REG_DOMAIN:
+	case TX_BATCH:
+	case RX_POLL:
+	case MEM_BENCH:
+	case STATS:
+	case CMD_LAT:
+	case RX_COALESCE:
+	case TX_FLOW:
+	case MEM_SPLIT:
+	case TXBUF:
+	case IRQ_ITER:
+	case BOOT:
 		pr_devel("opening filename=%s fmode=%o fidx=%d adev=%p\n",
 			dbgfs_files[fidx], file->f_mode, (int)fidx, adev);
 		break;
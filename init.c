@@ -18,6 +18,8 @@
 
 #include "acx_debug.h"
 
+#include <linux/ktime.h>
+
 #include "acx.h"
 #include "usb.h"
 #include "merge.h"
@@ -38,6 +40,77 @@
 #define USB_RX_CNT 10
 #define USB_TX_CNT 10
 
+static unsigned int acx_ring_size(unsigned int cnt)
+{
+	return rounddown_pow_of_two(clamp_t(unsigned int, cnt,
+					ACX_RING_MIN, ACX_RING_MAX));
+}
+
+static void acx_set_ring_sizes(acx_device_t *adev, unsigned int rx_cnt,
+			unsigned int tx_cnt)
+{
+	adev->rx_cnt = acx_ring_size(rx_cnt);
+	adev->rx_mask = adev->rx_cnt - 1;
+	adev->tx_cnt = acx_ring_size(tx_cnt);
+	adev->tx_mask = adev->tx_cnt - 1;
+}
+
+/*
+ * Ring sizes from the rxdescs/txdescs module params, chosen once at
+ * probe. If the fw can't take them, acx_init_mac() reduces them in
+ * adev, so later resets start from what worked.
+ */
+void acx_init_ring_sizes(acx_device_t *adev)
+{
+	acx_set_ring_sizes(adev, acx_rx_descs, acx_tx_descs);
+
+	if (adev->rx_cnt != acx_rx_descs || adev->tx_cnt != acx_tx_descs)
+		pr_info("%s: rings need a power of two of %d-%d descs, "
+			"using rx %u, tx %u\n", wiphy_name(adev->hw->wiphy),
+			ACX_RING_MIN, ACX_RING_MAX, adev->rx_cnt, adev->tx_cnt);
+}
+
+/* Bytes of acx memory taken by the acx100 desc rings */
+static u32 acx100_ring_area(acx_device_t *adev)
+{
+	return adev->tx_cnt * sizeof(txacxdesc_t)
+		+ adev->rx_cnt * sizeof(rxacxdesc_t) + 8;
+}
+
+/*
+ * The acx100 rings sit in acx memory from QueueStart, the tx/rx
+ * buffer pool follows up to PoolEnd. Halve the bigger ring until the
+ * rings fit their share, so larger rings don't starve the pool.
+ */
+static void acx100_fit_ring_sizes(acx_device_t *adev,
+				const acx_ie_memmap_t *memmap)
+{
+	u32 start = le32_to_cpu(memmap->QueueStart);
+	u32 end = le32_to_cpu(memmap->PoolEnd);
+	unsigned int rx_cnt = adev->rx_cnt, tx_cnt = adev->tx_cnt;
+	u32 area;
+
+	if (end <= start) {
+		log(L_INIT, "memmap: bad queue/pool range %X-%X\n", start, end);
+		return;
+	}
+	area = (end - start) / ACX100_RING_AREA_SHARE;
+
+	while (acx100_ring_area(adev) > area) {
+		if (adev->rx_cnt <= ACX_RING_MIN && adev->tx_cnt <= ACX_RING_MIN)
+			break;
+		if (adev->rx_cnt >= adev->tx_cnt)
+			acx_set_ring_sizes(adev, adev->rx_cnt / 2, adev->tx_cnt);
+		else
+			acx_set_ring_sizes(adev, adev->rx_cnt, adev->tx_cnt / 2);
+	}
+
+	if (adev->rx_cnt != rx_cnt || adev->tx_cnt != tx_cnt)
+		pr_info("%s: rings reduced to rx %u, tx %u descs to fit "
+			"acx memory\n", wiphy_name(adev->hw->wiphy),
+			adev->rx_cnt, adev->tx_cnt);
+}
+
 static int acx_init_max_template_generic(acx_device_t *adev, unsigned int len,
 				unsigned int cmdarg)
 {
@@ -200,6 +273,7 @@ static int acx111_create_dma_regions(acx_device_t *adev)
 	adev->num_hw_tx_queues = ACX111_NUM_HW_TX_QUEUES;
 
 	/* Calculate memory positions and queue sizes */
+retry:
 
 	/* Set up our host descriptor pool + data pool */
 	if (IS_PCI(adev) || IS_MEM(adev)) {
@@ -229,7 +303,7 @@ static int acx111_create_dma_regions(acx_device_t *adev)
 	 * (specified in units of 5%) */
 	memconf.fragmentation = ACX111_PERCENT(75);
 	/* Rx descriptor queue config */
-	memconf.rx_queue1_count_descs = RX_CNT;
+	memconf.rx_queue1_count_descs = adev->rx_cnt;
 	memconf.rx_queue1_type = 7;	/* must be set to 7 */
 
 	/* done by memset: memconf.rx_queue1_prio = 0; low prio */
@@ -248,7 +322,7 @@ static int acx111_create_dma_regions(acx_device_t *adev)
 
 	/* Tx descriptor queue config */
 	for (i = 0; i < ACX111_NUM_HW_TX_QUEUES; i++) {
-		memconf.tx_queue[i].count_descs = TX_CNT;
+		memconf.tx_queue[i].count_descs = adev->tx_cnt;
 
 		// TODO check if prio if up- or downwards
 		/* done by memset: memconf.tx_queue1_attributes = 0; lowest priority */
@@ -256,8 +330,19 @@ static int acx111_create_dma_regions(acx_device_t *adev)
 	}
 
 
-	if (OK != acx_configure(adev, &memconf, ACX111_IE_MEMORY_CONFIG_OPTIONS))
-		goto fail;
+	if (OK != acx_configure(adev, &memconf, ACX111_IE_MEMORY_CONFIG_OPTIONS)) {
+		/* The fw knows its memory: if it refuses our ring
+		 * sizes, fall back to the defaults */
+		if (adev->rx_cnt == RX_CNT && adev->tx_cnt == TX_CNT)
+			goto fail;
+		pr_info("%s: rings of rx %u, tx %u descs refused, "
+			"using the defaults\n", wiphy_name(adev->hw->wiphy),
+			adev->rx_cnt, adev->tx_cnt);
+		if (IS_PCI(adev) || IS_MEM(adev))
+			acx_free_desc_queues(adev);
+		acx_set_ring_sizes(adev, RX_CNT, TX_CNT);
+		goto retry;
+	}
 
 	memset(&queueconf, 0, sizeof(queueconf));
 	acx_interrogate(adev, &queueconf, ACX111_IE_QUEUE_CONFIG);
@@ -387,6 +472,37 @@ fail:
 	return res;
 }
 
+/*
+ * Tx share of the acx100 memory pool, in percent. Fixed by the
+ * memsplit param, or in auto mode moved a step towards tx or rx,
+ * whichever ran short more often since the last partition: tx
+ * starving for free txbuf blocks, or the rx ring running full.
+ */
+static unsigned int acx100_mem_tx_pct(acx_device_t *adev)
+{
+	unsigned long tx_starved, rx_full;
+	unsigned int pct;
+
+	if (acx_mem_split != ACX100_MEM_SPLIT_AUTO)
+		return clamp_t(int, acx_mem_split, ACX100_MEM_SPLIT_MIN,
+			ACX100_MEM_SPLIT_MAX);
+
+	pct = adev->mem_tx_pct ? : ACX100_MEM_SPLIT_DEFAULT;
+
+	tx_starved = adev->mem_tx_starved - adev->mem_tx_starved_last;
+	rx_full = adev->mem_rx_full - adev->mem_rx_full_last;
+	adev->mem_tx_starved_last = adev->mem_tx_starved;
+	adev->mem_rx_full_last = adev->mem_rx_full;
+
+	if (tx_starved > rx_full)
+		pct += ACX100_MEM_SPLIT_STEP;
+	else if (rx_full > tx_starved)
+		pct -= ACX100_MEM_SPLIT_STEP;
+
+	return clamp_t(unsigned int, pct, ACX100_MEM_SPLIT_MIN,
+		ACX100_MEM_SPLIT_MAX);
+}
+
 static int acx100_init_memory_pools(acx_device_t *adev,
 				const acx_ie_memmap_t *mmt)
 {
@@ -454,12 +570,18 @@ static int acx100_init_memory_pools(acx_device_t *adev,
 	else
 		MemoryConfigOption.DMA_config = cpu_to_le32(0x20000);
 
-	/* 50% of the allotment of memory blocks go to tx descriptors */
-	TxBlockNum = TotalMemoryBlocks / 2;
+	/* acx100_mem_tx_pct() of the allotment of memory blocks go to
+	 * tx descriptors */
+	adev->mem_tx_pct = acx100_mem_tx_pct(adev);
+	TxBlockNum = TotalMemoryBlocks * adev->mem_tx_pct / 100;
 	MemoryConfigOption.TxBlockNum = cpu_to_le16(TxBlockNum);
 
-	/* and 50% go to the rx descriptors */
+	/* and the rest go to the rx descriptors */
 	RxBlockNum = TotalMemoryBlocks - TxBlockNum;
+	adev->mem_tx_blocks = TxBlockNum;
+	adev->mem_rx_blocks = RxBlockNum;
+	log(L_INIT, "memory pool: %u%% tx, %u tx / %u rx blocks of %u bytes\n",
+		adev->mem_tx_pct, TxBlockNum, RxBlockNum, adev->memblocksize);
 	MemoryConfigOption.RxBlockNum = cpu_to_le16(RxBlockNum);
 
 	/* size of the tx and rx descriptor queues */
@@ -527,8 +649,10 @@ static int acx100_create_dma_regions(acx_device_t * adev)
 	if (OK != acx_interrogate(adev, &memmap, ACX1xx_IE_MEMORY_MAP))
 		goto fail;
 
+	acx100_fit_ring_sizes(adev, &memmap);
+
 	tx_queue_start = le32_to_cpu(memmap.QueueStart);
-	rx_queue_start = tx_queue_start + TX_CNT * sizeof(txacxdesc_t);
+	rx_queue_start = tx_queue_start + adev->tx_cnt * sizeof(txacxdesc_t);
 
 	log(L_DEBUG, "Initializing Queue Indicator\n");
 
@@ -541,8 +665,7 @@ static int acx100_create_dma_regions(acx_device_t * adev)
 	}
 
 	/* calculate size of queues */
-	queueconf.AreaSize = cpu_to_le32(TX_CNT * sizeof(txacxdesc_t) +
-					 RX_CNT * sizeof(rxacxdesc_t) + 8);
+	queueconf.AreaSize = cpu_to_le32(acx100_ring_area(adev));
 	queueconf.NumTxQueues = 1;	/* number of tx queues */
 	/* sets the beginning of the tx descriptor queue */
 	queueconf.TxQueueStart = memmap.QueueStart;
@@ -551,7 +674,7 @@ static int acx100_create_dma_regions(acx_device_t * adev)
 	queueconf.QueueOptions = 1;	/* auto reset descriptor */
 	/* sets the end of the rx descriptor queue */
 	queueconf.QueueEnd =
-	    cpu_to_le32(rx_queue_start + RX_CNT * sizeof(rxacxdesc_t)
+	    cpu_to_le32(rx_queue_start + adev->rx_cnt * sizeof(rxacxdesc_t)
 	    );
 	/* sets the beginning of the next queue */
 	queueconf.HostQueueEnd =
@@ -611,6 +734,7 @@ end:
 int acx_init_mac(acx_device_t * adev)
 {
 	int result = NOT_OK;
+	ktime_t t0 = ktime_get();
 
 	if (IS_PCI(adev) || IS_MEM(adev) ) {
 		adev->memblocksize = 256;	/* 256 is default */
@@ -618,6 +742,11 @@ int acx_init_mac(acx_device_t * adev)
 		 * chips have at least some firmware versions making use of an
 		 * external radio module */
 		acx_upload_radio(adev);
+
+		if (acx_mem_block_size)
+			adev->memblocksize = rounddown_pow_of_two(
+				clamp_t(unsigned int, acx_mem_block_size,
+					ACX_MEM_BLOCK_MIN, ACX_MEM_BLOCK_MAX));
 	}
 	else {
 		adev->memblocksize = 128;
@@ -653,6 +782,8 @@ int acx_init_mac(acx_device_t * adev)
 fail:
 	if (result)
 		pr_info("init_mac() FAILED\n");
+	adev->boot_ns[ACX_BOOT_INIT_MAC] =
+		ktime_to_ns(ktime_sub(ktime_get(), t0));
 
 	return result;
 }
@@ -3,6 +3,7 @@
 
 #include "acx.h"
 
+void acx_init_ring_sizes(acx_device_t *adev);
 int acx_init_mac(acx_device_t * adev);
 
 #endif
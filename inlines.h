@@ -435,4 +435,135 @@ INLINE_IO u16 read_slavemem16(acx_device_t *adev, u32 slave_address)
 	return val;
 }
 
+/*
+ * Descriptor write combining
+ *
+ * write_slavemem8/16() cost a read and a write of the whole word
+ * each, several of them on neighbouring fields of a descriptor.
+ * struct acxmem_desc_wc instead stages the field updates of one
+ * descriptor in host copies of its words, and acxmem_desc_wc_commit()
+ * writes each touched word once. A word is read from the acx at most
+ * once, when one of its fields is first read or partly written, and
+ * not at all if acxmem_desc_wc_assume_zero() knows its content.
+ *
+ * Same locking rules as the slavemem functions above.
+ */
+#define ACXMEM_DESC_WC_WORDS	16
+
+struct acxmem_desc_wc {
+	u32 base;			/* slave address of the desc */
+	u16 valid;			/* word[i] holds what's on the acx */
+	u16 dirty;			/* word[i] needs writing */
+	u32 word[ACXMEM_DESC_WC_WORDS];
+};
+
+INLINE_IO void acxmem_desc_wc_init(struct acxmem_desc_wc *wc, u32 base)
+{
+	wc->base = base;
+	wc->valid = 0;
+	wc->dirty = 0;
+}
+
+INLINE_IO u32 *acxmem_desc_wc_word(acx_device_t *adev,
+				struct acxmem_desc_wc *wc, int offset)
+{
+	int i = offset >> 2;
+
+	if (!(wc->valid & (1 << i))) {
+		wc->word[i] = read_slavemem32(adev, wc->base + (i << 2));
+		wc->valid |= 1 << i;
+	}
+	return &wc->word[i];
+}
+
+/*
+ * The words covering offset..offset+len are known to be zero on the
+ * acx (except for what is staged already), don't read them
+ */
+INLINE_IO void acxmem_desc_wc_assume_zero(struct acxmem_desc_wc *wc,
+					int offset, int len)
+{
+	int i;
+
+	for (i = offset >> 2; i <= (offset + len - 1) >> 2; i++) {
+		if (wc->valid & (1 << i))
+			continue;
+		wc->word[i] = 0;
+		wc->valid |= 1 << i;
+	}
+}
+
+INLINE_IO u8 acxmem_desc_wc_read8(acx_device_t *adev,
+				struct acxmem_desc_wc *wc, int offset)
+{
+	return (*acxmem_desc_wc_word(adev, wc, offset)
+		>> ((offset & 3) * 8)) & 0xff;
+}
+
+/*
+ * doesn't split across word boundaries
+ */
+INLINE_IO u16 acxmem_desc_wc_read16(acx_device_t *adev,
+				struct acxmem_desc_wc *wc, int offset)
+{
+	return (*acxmem_desc_wc_word(adev, wc, offset)
+		>> ((offset & 3) * 8)) & 0xffff;
+}
+
+INLINE_IO u32 acxmem_desc_wc_read32(acx_device_t *adev,
+				struct acxmem_desc_wc *wc, int offset)
+{
+	return *acxmem_desc_wc_word(adev, wc, offset);
+}
+
+INLINE_IO void acxmem_desc_wc_write8(acx_device_t *adev,
+				struct acxmem_desc_wc *wc, int offset, u8 val)
+{
+	u32 *word = acxmem_desc_wc_word(adev, wc, offset);
+	int shift = (offset & 3) * 8;
+
+	*word = (*word & ~(0xffU << shift)) | ((u32) val << shift);
+	wc->dirty |= 1 << (offset >> 2);
+}
+
+INLINE_IO void acxmem_desc_wc_write16(acx_device_t *adev,
+				struct acxmem_desc_wc *wc, int offset, u16 val)
+{
+	u32 *word = acxmem_desc_wc_word(adev, wc, offset);
+	int shift = (offset & 3) * 8;
+
+	*word = (*word & ~(0xffffU << shift)) | ((u32) val << shift);
+	wc->dirty |= 1 << (offset >> 2);
+}
+
+INLINE_IO void acxmem_desc_wc_write32(struct acxmem_desc_wc *wc,
+				int offset, u32 val)
+{
+	int i = offset >> 2;
+
+	wc->word[i] = val;
+	wc->valid |= 1 << i;
+	wc->dirty |= 1 << i;
+}
+
+/*
+ * Write the touched words, the one holding the byte at last_offset
+ * (the ownership byte) as the very last
+ */
+INLINE_IO void acxmem_desc_wc_commit(acx_device_t *adev,
+				struct acxmem_desc_wc *wc, int last_offset)
+{
+	int i, last = last_offset >> 2;
+
+	for (i = 0; i < ACXMEM_DESC_WC_WORDS; i++)
+		if (i != last && (wc->dirty & (1 << i)))
+			write_slavemem32(adev, wc->base + (i << 2),
+					wc->word[i]);
+
+	if (wc->dirty & (1 << last))
+		write_slavemem32(adev, wc->base + (last << 2), wc->word[last]);
+
+	wc->dirty = 0;
+}
+
 #endif /* _INLINES_H_ */
@@ -376,6 +376,17 @@ void acx_schedule_task(acx_device_t *adev, unsigned int set_flag)
 	ieee80211_queue_work(adev->hw, &adev->irq_work);
 }
 
+/* Rx irq coalescing delay is over: let acx_irq_work() handle rx */
+static enum hrtimer_restart acx_rx_coal_timer(struct hrtimer *timer)
+{
+	acx_device_t *adev = container_of(timer, struct acx_device,
+					rx_coal_timer);
+
+	acx_schedule_task(adev, 0);
+
+	return HRTIMER_NORESTART;
+}
+
 /*
 * acx_i_timer
 */
@@ -460,9 +471,12 @@ static void acx_watchdog_work(struct work_struct *work)
 /* Locking, queueing, etc. mechanics */
 int acx_init_mechanics(acx_device_t *adev)
 {
+	int cpu, i;
+
 	/* Locking */
 	spin_lock_init(&adev->spinlock);
 	mutex_init(&adev->mutex);
+	init_completion(&adev->cmd_done);
 
 	/* Irq work */
 	if (IS_USB(adev))
@@ -472,7 +486,15 @@ int acx_init_mechanics(acx_device_t *adev)
 
 	/* Skb tx-queue from mac80211 */
 	INIT_WORK(&adev->tx_work, acx_tx_work);
-	skb_queue_head_init(&adev->tx_queue);
+	for (i = 0; i < ACX_NUM_ACS; i++)
+		skb_queue_head_init(&adev->tx_queue[i]);
+	skb_queue_head_init(&adev->rx_skb_pool);
+	skb_queue_head_init(&adev->rx_poll_list);
+
+	hrtimer_init(&adev->rx_coal_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	adev->rx_coal_timer.function = acx_rx_coal_timer;
+	adev->rx_coal_mode = acx_rx_coalesce;
+	adev->rx_coal_stamp = jiffies;
 
 	INIT_DELAYED_WORK(&adev->watchdog_work, acx_watchdog_work);
 
@@ -484,21 +506,114 @@ int acx_init_mechanics(acx_device_t *adev)
 	if (!adev->ie_cmd_buf)
 		return -1;
 
+	/* Per-cpu tx/rx counters */
+	adev->pcpu_stats = alloc_percpu(struct acx_pcpu_stats);
+	if (!adev->pcpu_stats) {
+		kfree(adev->ie_cmd_buf);
+		adev->ie_cmd_buf = NULL;
+		return -1;
+	}
+	for_each_possible_cpu(cpu)
+		u64_stats_init(&per_cpu_ptr(adev->pcpu_stats, cpu)->syncp);
+
 	return 0;
 }
 
 int acx_free_mechanics(acx_device_t *adev)
 {
 	kfree(adev->ie_cmd_buf);
+	kfree(adev->acx_txbuf_blk);
+	adev->acx_txbuf_blk = NULL;
+	free_percpu(adev->pcpu_stats);
+	adev->pcpu_stats = NULL;
 
 	return 0;
 }
 
+/*
+ * BOM Statistics
+ * ==================================================
+ */
+
+/* The counters are bumped from process context (tx_work, irq_work)
+ * and from USB urb completion irqs, so the update sections run with
+ * irqs off to keep them from nesting on one cpu. */
+void acx_stats_rx(acx_device_t *adev, unsigned int len)
+{
+	struct acx_pcpu_stats *s;
+	unsigned long flags;
+
+	local_irq_save(flags);
+	s = this_cpu_ptr(adev->pcpu_stats);
+	u64_stats_update_begin(&s->syncp);
+	s->c.rx_packets++;
+	s->c.rx_bytes += len;
+	u64_stats_update_end(&s->syncp);
+	local_irq_restore(flags);
+}
+
+void acx_stats_tx(acx_device_t *adev, unsigned int len, int queue_id,
+		int rate_idx)
+{
+	struct acx_pcpu_stats *s;
+	unsigned long flags;
+
+	local_irq_save(flags);
+	s = this_cpu_ptr(adev->pcpu_stats);
+	u64_stats_update_begin(&s->syncp);
+	s->c.tx_packets++;
+	s->c.tx_bytes += len;
+	if (queue_id >= 0 && queue_id < ACX111_MAX_NUM_HW_TX_QUEUES)
+		s->c.tx_queue_packets[queue_id]++;
+	if (rate_idx >= 0 && rate_idx < ACX_STATS_RATES)
+		s->c.tx_rate_packets[rate_idx]++;
+	u64_stats_update_end(&s->syncp);
+	local_irq_restore(flags);
+}
+
+/*
+ * acx_stats_fold
+ *
+ * Sums up the per-cpu counters into sum, and updates the packet and
+ * byte counts in adev->stats from it.
+ */
+void acx_stats_fold(acx_device_t *adev, struct acx_stats_counters *sum)
+{
+	struct acx_stats_counters c;
+	struct acx_pcpu_stats *s;
+	unsigned int start;
+	int cpu, i;
+
+	memset(sum, 0, sizeof(*sum));
+
+	for_each_possible_cpu(cpu) {
+		s = per_cpu_ptr(adev->pcpu_stats, cpu);
+		do {
+			start = u64_stats_fetch_begin(&s->syncp);
+			c = s->c;
+		} while (u64_stats_fetch_retry(&s->syncp, start));
+
+		sum->rx_packets += c.rx_packets;
+		sum->rx_bytes += c.rx_bytes;
+		sum->tx_packets += c.tx_packets;
+		sum->tx_bytes += c.tx_bytes;
+		for (i = 0; i < ACX111_MAX_NUM_HW_TX_QUEUES; i++)
+			sum->tx_queue_packets[i] += c.tx_queue_packets[i];
+		for (i = 0; i < ACX_STATS_RATES; i++)
+			sum->tx_rate_packets[i] += c.tx_rate_packets[i];
+	}
+
+	adev->stats.rx_packets = sum->rx_packets;
+	adev->stats.rx_bytes = sum->rx_bytes;
+	adev->stats.tx_packets = sum->tx_packets;
+	adev->stats.tx_bytes = sum->tx_bytes;
+}
+
 
 int acx_init_ieee80211(acx_device_t *adev, struct ieee80211_hw *hw)
 {
 	hw->flags &= ~IEEE80211_HW_RX_INCLUDES_FCS;
-	hw->queues = 1;
+	hw->queues = ACX_NUM_ACS;
 	hw->wiphy->max_scan_ssids = 1;
 
 	/* OW TODO Check if RTS/CTS threshold can be included here */
@@ -602,6 +717,8 @@ int acx_op_add_interface(struct ieee80211_hw *ieee, struct ieee80211_VIF *vif)
 		break;
 	}
 
+	acx_cfg_begin(adev);
+
 	/* Reconfigure mac-address globally, affecting all vifs */
 	if (!mac_is_equal(mac_vif, adev->dev_addr)) {
 		memcpy(adev->dev_addr, mac_vif, ETH_ALEN);
@@ -611,6 +728,9 @@ int acx_op_add_interface(struct ieee80211_hw *ieee, struct ieee80211_VIF *vif)
 
 	acx_update_mode(adev);
 
+	if (acx_cfg_commit(adev) != OK)
+		logf0(L_ANY, "Setting station id or mode failed\n");
+
 	logf0(L_ANY, "Redoing cmd_join_bssid() after add_interface\n");
 	acx_cmd_join_bssid(adev, adev->bssid);
 
@@ -672,6 +792,8 @@ int acx_op_config(struct ieee80211_hw *hw, u32 changed)
 
 	logf1(L_DEBUG, "changed=%08X\n", changed);
 
+	acx_cfg_begin(adev);
+
 	/* Tx-Power power_level: requested transmit power (in dBm) */
 	if (changed & IEEE80211_CONF_CHANGE_POWER) {
 		logf1(L_DEBUG, "IEEE80211_CONF_CHANGE_POWER: %d\n",
@@ -696,6 +818,9 @@ int acx_op_config(struct ieee80211_hw *hw, u32 changed)
 		changed_not_done &= ~IEEE80211_CONF_CHANGE_CHANNEL;
 	}
 
+	if (acx_cfg_commit(adev) != OK)
+		ret = -EIO;
+
 	if (changed_not_done)
 		logf1(L_DEBUG, "changed_not_done=%08X\n", changed_not_done);
 
@@ -963,12 +1088,25 @@ int acx_conf_tx(struct ieee80211_hw *hw, u16 queue,
 #endif
 {
 	acx_device_t *adev = hw2adev(hw);
+	int ret = 0;
 
+	if (queue >= ACX_NUM_ACS)
+		return -EINVAL;
+
+	/* The AC order goes to the acx111 hw queue attributes, see
+	 * acx111_update_queue_prio(). The fw takes no aifs/cw/txop
+	 * values, the AC order on the host side is acx_tx_queue_go()'s */
 	acx_sem_lock(adev);
-    /* TODO */
+	adev->tx_ac_params[queue] = *params;
+	logf1(L_INIT, "queue %u: aifs=%u cw_min=%u cw_max=%u txop=%u\n",
+		queue, params->aifs, params->cw_min, params->cw_max,
+		params->txop);
+	if (test_bit(ACX_FLAG_HW_UP, &adev->flags)
+		&& acx111_update_queue_prio(adev) != OK)
+		ret = -EIO;
 	acx_sem_unlock(adev);
 
-	return 0;
+	return ret;
 }
 
 int acx_op_set_tim(struct ieee80211_hw *hw, struct ieee80211_sta *sta, bool set)
@@ -1008,7 +1146,7 @@ int acx_e_op_get_tx_stats(struct ieee80211_hw *hw,
 	acx_sem_lock(adev);
 
 	stats->len = 0;
-	stats->limit = TX_CNT;
+	stats->limit = adev->tx_cnt;
 	stats->count = 0;
 
 	acx_sem_unlock(adev);
@@ -1029,13 +1167,17 @@ void acx_op_tx(struct ieee80211_hw *hw, struct ieee80211_tx_control *control,
 #endif
 {
 	acx_device_t *adev = hw2adev(hw);
+	int ac = skb_get_queue_mapping(skb);
+
+	if (ac >= ACX_NUM_ACS)
+		ac = ACX_NUM_ACS - 1;
 
-	skb_queue_tail(&adev->tx_queue, skb);
+	skb_queue_tail(&adev->tx_queue[ac], skb);
 
 	ieee80211_queue_work(adev->hw, &adev->tx_work);
 
-	if (skb_queue_len(&adev->tx_queue) >= ACX_TX_QUEUE_MAX_LENGTH)
-		acx_stop_queue(adev->hw, NULL);
+	if (skb_queue_len(&adev->tx_queue[ac]) >= ACX_TX_QUEUE_MAX_LENGTH)
+		acx_stop_ac_queue(adev->hw, ac, NULL);
 
 	#if CONFIG_ACX_MAC80211_VERSION < KERNEL_VERSION(2, 6, 39)
 	return 0;
@@ -1121,6 +1263,7 @@ int acx_recover_hw(acx_device_t *adev)
 
 	acx_remove_interface(adev, adev->vif);
 	acx_stop(adev);
+	acx_cfg_shadow_reset(adev);
 
 	ieee80211_restart_hw(adev->hw);
 
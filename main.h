@@ -15,6 +15,11 @@ int acx_stop_watchdog(acx_device_t *adev);
 
 int acx_init_mechanics(acx_device_t *adev);
 int acx_free_mechanics(acx_device_t *adev);
+
+void acx_stats_rx(acx_device_t *adev, unsigned int len);
+void acx_stats_tx(acx_device_t *adev, unsigned int len, int queue_id,
+		int rate_idx);
+void acx_stats_fold(acx_device_t *adev, struct acx_stats_counters *sum);
 int acx_init_ieee80211(acx_device_t *adev, struct ieee80211_hw *hw);
 
 void acx_after_interrupt_task(acx_device_t *adev);
@@ -60,12 +60,15 @@
 #include <linux/pm.h>
 #include <linux/vmalloc.h>
 #include <linux/workqueue.h>
+#include <linux/ktime.h>
+#include <linux/random.h>
 #include <linux/nl80211.h>
 
 #include <net/iw_handler.h>
 #include <net/mac80211.h>
 
 #include <asm/io.h>
+#include <asm/unaligned.h>
 
 #include "acx.h"
 #include "merge.h"
@@ -182,142 +185,122 @@ void acxmem_dump_mem(acx_device_t *adev, u32 start, int length)
 /*
  * Copy from slave memory
  *
- * TODO - rewrite using address autoincrement, handle partial words
+ * The slave address is written once, then the aligned words are
+ * streamed in address auto-increment mode. A partial first or last
+ * word is read on its own. destination needs no alignment.
  */
 /* = static */
 void acxmem_copy_from_slavemem(acx_device_t *adev, u8 *destination,
 			u32 source, int count)
 {
-	u32 tmp = 0;
-	u8 *ptmp = (u8 *) &tmp;
+	u32 tmp;
+	int head, n;
 
 	ACXMEM_WARN_NOT_SPIN_LOCKED;
 
-	/*
-	 * Right now I'm making the assumption that the destination is
-	 * aligned, but I'd better check.
-	 */
-	if ((uintptr_t) destination & 3) {
-		pr_acx("copy_from_slavemem: warning!  destination not word-aligned!\n");
-	}
-
-	while (count >= 4) {
-		write_reg32(adev, IO_ACX_SLV_MEM_ADDR, source);
-		udelay (10);
-		*((u32 *) destination) = read_reg32(adev, IO_ACX_SLV_MEM_DATA);
-		count -= 4;
-		source += 4;
-		destination += 4;
+	/* unaligned head: pick the wanted bytes from the first word */
+	head = source & 3;
+	if (head && count > 0) {
+		tmp = read_slavemem32(adev, source - head);
+		n = min(count, 4 - head);
+		memcpy(destination, (u8 *) &tmp + head, n);
+		destination += n;
+		source += n;
+		count -= n;
 	}
 
-	/*
-	 * If the word reads above didn't satisfy the count, read one
-	 * more word and transfer a byte at a time until the request
-	 * is satisfied.
-	 */
-	if (count) {
+	if (count >= 4) {
+		write_reg32(adev, IO_ACX_SLV_MEM_CTL, 1); /* use autoincrement mode */
 		write_reg32(adev, IO_ACX_SLV_MEM_ADDR, source);
-		udelay (10);
-		tmp = read_reg32(adev, IO_ACX_SLV_MEM_DATA);
-		while (count--) {
-			*destination++ = *ptmp++;
+		udelay(10);
+
+		while (count >= 4) {
+			put_unaligned(read_reg32(adev, IO_ACX_SLV_MEM_DATA),
+				(u32 *) destination);
+			count -= 4;
+			source += 4;
+			destination += 4;
 		}
 	}
 
+	/* partial tail word */
+	if (count > 0) {
+		tmp = read_slavemem32(adev, source);
+		memcpy(destination, &tmp, count);
+	}
 }
 
 /*
  * Copy to slave memory
  *
- * TODO - rewrite using autoincrement, handle partial words
+ * Same as acxmem_copy_from_slavemem(): one address write, then the
+ * aligned words in auto-increment mode. A partial first or last word
+ * is merged into what the acx has there. source needs no alignment.
  */
 /* = static */
 void acxmem_copy_to_slavemem(acx_device_t *adev, u32 destination,
 			u8 *source, int count)
 {
-	u32 tmp = 0;
-	u8* ptmp = (u8 *) &tmp;
-	static u8 src[512]; /* make static to avoid huge stack objects */
+	u32 tmp;
+	int head, n;
 
 	ACXMEM_WARN_NOT_SPIN_LOCKED;
 
-	/*
-	 * For now, make sure the source is word-aligned by copying it
-	 * to a word-aligned buffer.  Someday rewrite to avoid the
-	 * extra copy.
-	 */
-	if (count > sizeof(src)) {
-		pr_acx("copy_to_slavemem: Warning! buffer overflow!\n");
-		count = sizeof(src);
+	/* unaligned head: read-modify-write the first word */
+	head = destination & 3;
+	if (head && count > 0) {
+		tmp = read_slavemem32(adev, destination - head);
+		n = min(count, 4 - head);
+		memcpy((u8 *) &tmp + head, source, n);
+		write_slavemem32(adev, destination - head, tmp);
+		source += n;
+		destination += n;
+		count -= n;
 	}
-	memcpy(src, source, count);
-	source = src;
 
-	while (count >= 4) {
+	if (count >= 4) {
+		write_reg32(adev, IO_ACX_SLV_MEM_CTL, 1); /* use autoincrement mode */
 		write_reg32(adev, IO_ACX_SLV_MEM_ADDR, destination);
-		udelay (10);
-		write_reg32(adev, IO_ACX_SLV_MEM_DATA, *((u32 *) source));
-		count -= 4;
-		source += 4;
-		destination += 4;
-	}
-
-	/*
-	 * If there are leftovers read the next word from the acx and
-	 * merge in what they want to write.
-	 */
-	if (count) {
-		write_reg32(adev, IO_ACX_SLV_MEM_ADDR, destination);
-		udelay (10);
-		tmp = read_reg32(adev, IO_ACX_SLV_MEM_DATA);
-		while (count--) {
-			*ptmp++ = *source++;
+		udelay(10);
+
+		while (count >= 4) {
+			write_reg32(adev, IO_ACX_SLV_MEM_DATA,
+				get_unaligned((u32 *) source));
+			count -= 4;
+			source += 4;
+			destination += 4;
 		}
-		/*
-		 * reset address in case we're currently in
-		 * auto-increment mode
-		 */
-		write_reg32(adev, IO_ACX_SLV_MEM_ADDR, destination);
-		udelay (10);
-		write_reg32(adev, IO_ACX_SLV_MEM_DATA, tmp);
-		udelay (10);
 	}
 
+	/* partial tail word: merge with what's on the acx */
+	if (count > 0) {
+		tmp = read_slavemem32(adev, destination);
+		memcpy(&tmp, source, count);
+		write_slavemem32(adev, destination, tmp);
+	}
 }
 
 /*
- * Block copy to slave buffers using memory block chain mode.  Copies
- * to the ACX transmit buffer structure with minimal intervention on
- * our part.  Interrupts should be disabled when calling this.
+ * Chain copies stream whole words through ACX_SLV_MEM_DATA. Host
+ * buffers that aren't word aligned are streamed by shifting and
+ * merging neighbouring aligned words, no bounce buffer needed.
+ *
+ * ACXMEM_BYTES_DOWN(w, n) moves the bytes of w n places down in
+ * memory order (dropping the first n), ACXMEM_BYTES_UP(w, n) n places
+ * up. n is 1..3.
  */
-/* =static */
-void acxmem_chaincopy_to_slavemem(acx_device_t *adev, u32 destination,
-				u8 *source, int count)
+#ifdef __BIG_ENDIAN
+#define ACXMEM_BYTES_DOWN(w, n)	((w) << (8 * (n)))
+#define ACXMEM_BYTES_UP(w, n)	((w) >> (8 * (n)))
+#else
+#define ACXMEM_BYTES_DOWN(w, n)	((w) >> (8 * (n)))
+#define ACXMEM_BYTES_UP(w, n)	((w) << (8 * (n)))
+#endif
+
+/* Set up memory block chain mode at the first block of chain */
+static void acxmem_chaincopy_start(acx_device_t *adev, u32 chain)
 {
 	u32 val;
-	u32 *data = (u32 *) source;
-	static u8 aligned_source[WLAN_A4FR_MAXLEN_WEP_FCS];
-
-	ACXMEM_WARN_NOT_SPIN_LOCKED;
-
-	/*
-	 * Warn if the pointers don't look right.  Destination must
-	 * fit in [23:5] with zero elsewhere and source should be 32
-	 * bit aligned.  This should never happen since we're in
-	 * control of both, but I want to know about it if it does.
-	 */
-	if ((destination & 0x00ffffe0) != destination) {
-		pr_acx("chaincopy: destination block 0x%04x not aligned!\n",
-			destination);
-	}
-	if (count > sizeof aligned_source) {
-		pr_err("chaincopy_to_slavemem overflow!\n");
-		count = sizeof aligned_source;
-	}
-	if ((uintptr_t) source & 3) {
-		memcpy(aligned_source, source, count);
-		data = (u32 *) aligned_source;
-	}
 
 	/*
 	 * SLV_MEM_CTL[17:16] = memory block chain mode with
@@ -331,103 +314,143 @@ void acxmem_chaincopy_to_slavemem(acx_device_t *adev, u32 destination,
 	 * SLV_MEM_CP[23:5] = start of 1st block
 	 * SLV_MEM_CP[3:2] = offset to memblkptr = 0
 	 */
-	val = destination & 0x00ffffe0;
+	val = chain & 0x00ffffe0;
 	acx_writel (val, adev->iobase + ACX_SLV_MEM_CP);
 
 	/*
 	 * SLV_MEM_ADDR[23:2] = SLV_MEM_CTL[5:2] + SLV_MEM_CP[23:5]
 	 */
-	val = (destination & 0x00ffffe0) + (1 << 2);
+	val = (chain & 0x00ffffe0) + (1 << 2);
 	acx_writel (val, adev->iobase + ACX_SLV_MEM_ADDR);
+}
+
+/*
+ * Block copy to slave buffers using memory block chain mode.  Copies
+ * to the ACX transmit buffer structure with minimal intervention on
+ * our part.  Interrupts should be disabled when calling this.
+ */
+/* =static */
+void acxmem_chaincopy_to_slavemem(acx_device_t *adev, u32 destination,
+				u8 *source, int count)
+{
+	const u32 *data;
+	u32 lo, hi;
+	int off;
+
+	ACXMEM_WARN_NOT_SPIN_LOCKED;
+
+	/*
+	 * Warn if the pointer doesn't look right.  Destination must
+	 * fit in [23:5] with zero elsewhere.  This should never
+	 * happen since we're in control of it, but I want to know
+	 * about it if it does.
+	 */
+	if ((destination & 0x00ffffe0) != destination) {
+		pr_acx("chaincopy: destination block 0x%04x not aligned!\n",
+			destination);
+	}
+
+	acxmem_chaincopy_start(adev, destination);
+
+	off = (uintptr_t) source & 3;
+	data = (const u32 *) (source - off);
 
 	/*
 	 * Write the data to the slave data register, rounding up to
 	 * the end of the word containing the last byte (hence the >
-	 * 0)
+	 * 0). The aligned word holding the last byte may be read
+	 * beyond count, but never the word after it.
 	 */
+	if (!off) {
+		while (count > 0) {
+			acx_writel (*data++, adev->iobase + ACX_SLV_MEM_DATA);
+			count -= 4;
+		}
+		return;
+	}
+
+	lo = *data++;
 	while (count > 0) {
-		acx_writel (*data++, adev->iobase + ACX_SLV_MEM_DATA);
+		hi = (count > 4 - off) ? *data++ : 0;
+		acx_writel (ACXMEM_BYTES_DOWN(lo, off)
+			| ACXMEM_BYTES_UP(hi, 4 - off),
+			adev->iobase + ACX_SLV_MEM_DATA);
+		lo = hi;
 		count -= 4;
 	}
-
 }
 
 /*
  * Block copy from slave buffers using memory block chain mode.
  * Copies from the ACX receive buffer structures with minimal
  * intervention on our part.  Interrupts should be disabled when
- * calling this.
+ * calling this. Exactly count bytes are stored to destination.
  */
 /* = static  */
 void acxmem_chaincopy_from_slavemem(acx_device_t *adev, u8 *destination,
 				u32 source, int count)
 {
-	u32 val;
-	u32 *data = (u32 *) destination;
-	static u8 aligned_destination[WLAN_A4FR_MAXLEN_WEP_FCS];
-	int saved_count = count;
+	u32 *data;
+	u32 val, carry;
+	int off, n;
 
 	ACXMEM_WARN_NOT_SPIN_LOCKED;
 
 	/*
-	 * Warn if the pointers don't look right.  Destination must
-	 * fit in [23:5] with zero elsewhere and source should be 32
-	 * bit aligned.  Turns out the network stack sends unaligned
-	 * things, so fix them before copying to the ACX.
+	 * Warn if the pointer doesn't look right.  Source must fit
+	 * in [23:5] with zero elsewhere.
 	 */
 	if ((source & 0x00ffffe0) != source) {
 		pr_acx("chaincopy: source block 0x%04x not aligned!\n", source);
 		acxmem_dump_mem(adev, 0, 0x10000);
 	}
-	if ((uintptr_t) destination & 3) {
-		/* printk ("acx chaincopy: data destination not word aligned!\n"); */
-		data = (u32 *) aligned_destination;
-		if (count > sizeof aligned_destination) {
-			pr_err("chaincopy_from_slavemem overflow!\n");
-			count = sizeof aligned_destination;
-		}
-	}
 
-	/*
-	 * SLV_MEM_CTL[17:16] = memory block chain mode with auto-increment
-	 * SLV_MEM_CTL[5:2] = offset to data portion = 1 word
-	 */
-	val = (2 << 16) | (1 << 2);
-	acx_writel (val, adev->iobase + ACX_SLV_MEM_CTL);
+	if (count <= 0)
+		return;
 
-	/*
-	 * SLV_MEM_CP[23:5] = start of 1st block
-	 * SLV_MEM_CP[3:2] = offset to memblkptr = 0
-	 */
-	val = source & 0x00ffffe0;
-	acx_writel (val, adev->iobase + ACX_SLV_MEM_CP);
+	acxmem_chaincopy_start(adev, source);
 
 	/*
-	 * SLV_MEM_ADDR[23:2] = SLV_MEM_CTL[5:2] + SLV_MEM_CP[23:5]
+	 * Unaligned destination: store the head bytes of the first
+	 * word, the rest of it carries over into the first aligned
+	 * word.
 	 */
-	val = (source & 0x00ffffe0) + (1 << 2);
-	acx_writel (val, adev->iobase + ACX_SLV_MEM_ADDR);
+	off = (uintptr_t) destination & 3;
+	carry = 0;
+	if (off) {
+		val = acx_readl (adev->iobase + ACX_SLV_MEM_DATA);
+		n = min(count, 4 - off);
+		memcpy(destination, &val, n);
+		destination += n;
+		count -= n;
+		carry = ACXMEM_BYTES_DOWN(val, 4 - off);
+	}
+	data = (u32 *) destination;
 
 	/*
-	 * Read the data from the slave data register, rounding up to
-	 * the end of the word containing the last byte (hence the >
-	 * 0)
+	 * Read the data from the slave data register, merging each
+	 * word with the bytes carried over from the previous one.
 	 */
-	while (count > 0) {
-		*data++ = acx_readl (adev->iobase + ACX_SLV_MEM_DATA);
+	while (count >= 4) {
+		val = acx_readl (adev->iobase + ACX_SLV_MEM_DATA);
+		if (off) {
+			*data++ = carry | ACXMEM_BYTES_UP(val, off);
+			carry = ACXMEM_BYTES_DOWN(val, 4 - off);
+		} else
+			*data++ = val;
 		count -= 4;
 	}
 
-	/*
-	 * If the destination wasn't aligned, we would have saved it
-	 * in the aligned buffer, so copy it where it should go.
-	 */
-	if ((uintptr_t) destination & 3) {
-		memcpy(destination, aligned_destination, saved_count);
+	/* partial tail word, another read only if the carry is short */
+	if (count > 0) {
+		if (count > off) {
+			val = acx_readl (adev->iobase + ACX_SLV_MEM_DATA);
+			carry = off ? carry | ACXMEM_BYTES_UP(val, off) : val;
+		}
+		memcpy(data, &carry, count);
 	}
 }
 
-
 /*
  * In the generic slave memory access mode, most of the stuff in the
  * txhostdesc_t is unused.  It's only here because the rest of the ACX
@@ -726,7 +749,8 @@ static int acxmem_load_firmware(acx_device_t *adev)
 	snprintf(radio_image_filename, sizeof(radio_image_filename),
 	        MEM_RADIO_IMAGE_FILENAME, adev->radio_type);
 
-	return acx_load_firmware(adev, fw_image_filename, radio_image_filename);
+	return acx_load_firmware(adev, fw_image_filename,
+			radio_image_filename, 0);
 }
 
 #if PATCH_AROUND_BAD_SPOTS
@@ -877,7 +901,7 @@ int acxmem_dbgfs_diag_output(struct seq_file *file,
 	seq_printf(file, "** Rx buf **\n");
 	rxdesc = adev->hw_rx_queue.acxdescinfo.start;
 	if (rxdesc)
-		for (i = 0; i < RX_CNT; i++) {
+		for (i = 0; i < adev->rx_cnt; i++) {
 			rtl = (i == adev->hw_rx_queue.tail) ? " [tail]" : "";
 			Ctl_8 = read_slavemem8(adev, (uintptr_t)
 					&(rxdesc->Ctl_8));
@@ -924,7 +948,7 @@ int acxmem_dbgfs_diag_output(struct seq_file *file,
 
 	txdesc = adev->hw_tx_queue[0].acxdescinfo.start;
 	if (txdesc) {
-		for (i = 0; i < TX_CNT; i++) {
+		for (i = 0; i < adev->tx_cnt; i++) {
 			thd = (i == adev->hw_tx_queue[0].head) ? " [head]" : "";
 			ttl = (i == adev->hw_tx_queue[0].tail) ? " [tail]" : "";
 			acxmem_copy_from_slavemem(adev, (u8 *) &txd,
@@ -1042,16 +1066,235 @@ int acxmem_dbgfs_diag_output(struct seq_file *file,
 }
 #endif // acxmem_proc_diag_output()
 
+/*
+ * Slave memory copy benchmark, shown by the mem_bench debugfs file.
+ *
+ * Reads a window of the command mailbox and writes the same bytes
+ * back, so the acx sees no change. The caller holds the sem, so no
+ * command can be in flight.
+ */
+#define ACXMEM_BENCH_LEN	512
+#define ACXMEM_BENCH_LOOPS	64
+
+static void acxmem_bench_print(struct seq_file *file, const char *dir,
+			u64 bytes, u64 ns)
+{
+	/* bytes/ns * 1000 = MB/s, keep two decimals */
+	u64 mbps100 = ns ? div64_u64(bytes * 100000, ns) : 0;
+
+	seq_printf(file, "%s: %llu bytes in %llu us, %llu.%02llu MB/s\n",
+		dir, bytes, div64_u64(ns, 1000),
+		div64_u64(mbps100, 100), mbps100 % 100);
+}
+
+/*
+ * Chain copy self-test, run by the mem_bench debugfs file: random
+ * frames from random host offsets go through a txbuf chain and back
+ * to another random offset. Each round must return the reference
+ * bytes, and leave the guard bytes behind the copy untouched.
+ */
+#define ACXMEM_SELFTEST_ROUNDS	64
+#define ACXMEM_SELFTEST_GUARD	4
+
+static int acxmem_chaincopy_selftest(struct seq_file *file,
+				acx_device_t *adev)
+{
+	u8 *ref, *src, *dst;
+	u32 chain;
+	u16 rnd[3];
+	int i, j, len, soff, doff, failed = 0, skipped = 0;
+	const int size = WLAN_A4FR_MAXLEN_WEP_FCS + 4 + ACXMEM_SELFTEST_GUARD;
+
+	acxmem_lock_flags;
+
+	ref = kmalloc(size, GFP_KERNEL);
+	src = kmalloc(size, GFP_KERNEL);
+	dst = kmalloc(size, GFP_KERNEL);
+	if (!ref || !src || !dst)
+		goto out;
+
+	for (i = 0; i < ACXMEM_SELFTEST_ROUNDS; i++) {
+		get_random_bytes(rnd, sizeof(rnd));
+		len = 1 + rnd[0] % WLAN_A4FR_MAXLEN_WEP_FCS;
+		soff = rnd[1] & 3;
+		doff = rnd[2] & 3;
+
+		get_random_bytes(ref, len);
+		memcpy(src + soff, ref, len);
+		memset(dst, 0x5a, size);
+
+		acxmem_lock();
+		chain = acxmem_allocate_acx_txbuf_space(adev, len);
+		if (chain) {
+			acxmem_chaincopy_to_slavemem(adev, chain, src + soff,
+						len);
+			acxmem_chaincopy_from_slavemem(adev, dst + doff,
+						chain, len);
+			acxmem_reclaim_acx_txbuf_space(adev, chain);
+		}
+		acxmem_unlock();
+
+		if (!chain) {
+			skipped++;
+			continue;
+		}
+
+		for (j = 0; j < ACXMEM_SELFTEST_GUARD; j++)
+			if (dst[doff + len + j] != 0x5a)
+				break;
+
+		if (memcmp(dst + doff, ref, len)
+			|| j < ACXMEM_SELFTEST_GUARD) {
+			if (failed++ < 8)
+				seq_printf(file, "chaincopy: len %d, src+%d, "
+					"dst+%d: FAILED\n", len, soff, doff);
+		}
+	}
+
+	seq_printf(file, "chaincopy self-test: %d rounds, %d failed, "
+		"%d skipped (no txbuf space)\n",
+		ACXMEM_SELFTEST_ROUNDS, failed, skipped);
+out:
+	kfree(dst);
+	kfree(src);
+	kfree(ref);
+
+	return (ref && src && dst) ? 0 : -ENOMEM;
+}
+
+int acxmem_dbgfs_bench_output(struct seq_file *file, acx_device_t *adev)
+{
+	u32 addr = (uintptr_t) (adev->cmd_area + 4);
+	u64 ns_from = 0, ns_to = 0;
+	ktime_t t0;
+	u8 *buf;
+	int i;
+
+	acxmem_lock_flags;
+
+	buf = kmalloc(ACXMEM_BENCH_LEN, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	for (i = 0; i < ACXMEM_BENCH_LOOPS; i++) {
+		acxmem_lock();
+		t0 = ktime_get();
+		acxmem_copy_from_slavemem(adev, buf, addr, ACXMEM_BENCH_LEN);
+		ns_from += ktime_to_ns(ktime_sub(ktime_get(), t0));
+
+		t0 = ktime_get();
+		acxmem_copy_to_slavemem(adev, addr, buf, ACXMEM_BENCH_LEN);
+		ns_to += ktime_to_ns(ktime_sub(ktime_get(), t0));
+		acxmem_unlock();
+	}
+
+	kfree(buf);
+
+	seq_printf(file, "slave memory copy, %d x %d bytes at 0x%04x:\n",
+		ACXMEM_BENCH_LOOPS, ACXMEM_BENCH_LEN, addr);
+	acxmem_bench_print(file, "from acx",
+		(u64) ACXMEM_BENCH_LOOPS * ACXMEM_BENCH_LEN, ns_from);
+	acxmem_bench_print(file, "to acx",
+		(u64) ACXMEM_BENCH_LOOPS * ACXMEM_BENCH_LEN, ns_to);
+
+	return acxmem_chaincopy_selftest(file, adev);
+}
+
+/*
+ * Cross-check of the txbuf mirror against the block chains on the
+ * acx, shown by the txbuf debugfs file. Walks the free list and every
+ * allocated chain of the mirror and compares each link with the word
+ * in slave memory.
+ */
+static int acxmem_txbuf_check_chain(struct seq_file *file,
+				acx_device_t *adev, unsigned int first,
+				int count, int *bad)
+{
+	struct acxmem_txbuf_blk *blk = adev->acx_txbuf_blk;
+	unsigned int cur = first;
+	u32 word, want;
+	int n;
+
+	for (n = 1; ; n++) {
+		if (cur >= adev->acx_txbuf_numblocks) {
+			seq_printf(file, "chain 0x%04x: bad block %u\n",
+				acxmem_txbuf_addr(adev, first), cur);
+			(*bad)++;
+			return n;
+		}
+
+		word = read_slavemem32(adev, acxmem_txbuf_addr(adev, cur));
+		if (n == count || n >= adev->acx_txbuf_numblocks)
+			want = ACXMEM_TXBUF_END_MARK;
+		else
+			want = acxmem_txbuf_addr(adev, blk[cur].next) >> 5;
+
+		if (word != want && (*bad)++ < 16)
+			seq_printf(file, "chain 0x%04x: block 0x%04x=%08x, "
+				"mirror %08x\n", acxmem_txbuf_addr(adev, first),
+				acxmem_txbuf_addr(adev, cur), word, want);
+
+		if (want == ACXMEM_TXBUF_END_MARK)
+			return n;
+		cur = blk[cur].next;
+	}
+}
+
+int acxmem_dbgfs_txbuf_output(struct seq_file *file, acx_device_t *adev)
+{
+	struct acxmem_txbuf_blk *blk = adev->acx_txbuf_blk;
+	int i, chains = 0, used = 0, free = 0, bad = 0;
+
+	acxmem_lock_flags;
+
+	if (!blk) {
+		seq_printf(file, "no txbuf mirror\n");
+		return 0;
+	}
+
+	acxmem_lock();
+
+	if (adev->acx_txbuf_blocks_free)
+		free = acxmem_txbuf_check_chain(file, adev,
+			acxmem_txbuf_index(adev, adev->acx_txbuf_free),
+			adev->acx_txbuf_blocks_free, &bad);
+
+	for (i = 0; i < adev->acx_txbuf_numblocks; i++) {
+		if (!blk[i].count)
+			continue;
+		chains++;
+		used += acxmem_txbuf_check_chain(file, adev, i,
+					blk[i].count, &bad);
+	}
+
+	acxmem_unlock();
+
+	seq_printf(file, "blocks: %d of %u bytes at 0x%04x\n"
+		"free list: 0x%04x, %d blocks (%d walked)\n"
+		"chains: %d, %d blocks\n"
+		"mismatches: %d\n",
+		adev->acx_txbuf_numblocks, adev->memblocksize,
+		adev->acx_txbuf_start, adev->acx_txbuf_free,
+		adev->acx_txbuf_blocks_free, free, chains, used, bad);
+	if (free + used != adev->acx_txbuf_numblocks)
+		seq_printf(file, "lost blocks: %d\n",
+			adev->acx_txbuf_numblocks - free - used);
+
+	return 0;
+}
+
 /*
  * BOM Rx Path
  * ==================================================
  */
 
-void acxmem_process_rxdesc(acx_device_t *adev)
+void acxmem_process_rxdesc(acx_device_t *adev, unsigned int budget)
 {
 	rxhostdesc_t *hostdesc;
-	rxacxdesc_t *rxdesc;
+	rxacxdesc_t *rxdesc, *last;
+	struct acxmem_desc_wc wc;
 	unsigned count, tail;
+	unsigned int done = 0;
 	u32 addr;
 	u8 Ctl_8;
 
@@ -1063,12 +1306,12 @@ void acxmem_process_rxdesc(acx_device_t *adev)
 	 * rx_tail and the full descriptor we're supposed to
 	 * handle. */
 	tail = adev->hw_rx_queue.tail;
-	count = RX_CNT;
+	count = adev->rx_cnt;
 	while (1) {
 		hostdesc = &adev->hw_rx_queue.hostdescinfo.start[tail];
 		rxdesc = &adev->hw_rx_queue.acxdescinfo.start[tail];
 		/* advance tail regardless of outcome of the below test */
-		tail = (tail + 1) % RX_CNT;
+		tail = (tail + 1) & adev->rx_mask;
 
 		/*
 		 * Unlike the PCI interface, where the ACX can write
@@ -1078,8 +1321,9 @@ void acxmem_process_rxdesc(acx_device_t *adev)
 		 * rx descriptor on the ACX, which should be
 		 * 0x11000000 if we should process it.
 		 */
-		Ctl_8 = hostdesc->hd.Ctl_16
-			= read_slavemem8(adev, (uintptr_t) &(rxdesc->Ctl_8));
+		acxmem_desc_wc_init(&wc, (uintptr_t) rxdesc);
+		Ctl_8 = hostdesc->hd.Ctl_16 = acxmem_desc_wc_read8(adev, &wc,
+					offsetof(rxacxdesc_t, Ctl_8));
 					
 		if ((Ctl_8 & DESC_CTL_HOSTOWN) && (Ctl_8 & DESC_CTL_ACXDONE))
 			break; /* found it! */
@@ -1089,6 +1333,17 @@ void acxmem_process_rxdesc(acx_device_t *adev)
 			goto end;
 	}
 
+	/* The desc before our tail is the last the acx fills: if
+	 * that's done too, the ring ran full. Feeds the auto tx/rx
+	 * memory split, see acx100_mem_tx_pct() */
+	if (count == adev->rx_cnt) {
+		last = &adev->hw_rx_queue.acxdescinfo.start[
+			(adev->hw_rx_queue.tail - 1) & adev->rx_mask];
+		if (read_slavemem8(adev, (uintptr_t) &last->Ctl_8)
+			& DESC_CTL_ACXDONE)
+			adev->mem_rx_full++;
+	}
+
 	/* now process descriptors, starting with the first we figured
 	 * out */
 	while (1) {
@@ -1102,8 +1357,8 @@ void acxmem_process_rxdesc(acx_device_t *adev)
 			/*
 			 * slave interface - pull data now
 			 */
-			hostdesc->hd.length = read_slavemem16(adev,
-					(uintptr_t) &(rxdesc->total_length));
+			hostdesc->hd.length = acxmem_desc_wc_read16(adev, &wc,
+					offsetof(rxacxdesc_t, total_length));
 
 			/*
 			 * hostdesc->data is an rxbuffer_t, which
@@ -1112,8 +1367,8 @@ void acxmem_process_rxdesc(acx_device_t *adev)
 			 * information takes up an additional 12
 			 * bytes, so add that to the length we copy.
 			 */
-			addr = read_slavemem32(adev,
-					(uintptr_t) &(rxdesc->ACXMemPtr));
+			addr = acxmem_desc_wc_read32(adev, &wc,
+					offsetof(rxacxdesc_t, ACXMemPtr));
 			if (addr) {
 				/*
 				 * How can &(rxdesc->ACXMemPtr) above
@@ -1132,7 +1387,7 @@ void acxmem_process_rxdesc(acx_device_t *adev)
 					hostdesc->hd.length
 					+ (uintptr_t) &((rxbuffer_t *) 0)->hdr_a3);
 
-				acx_process_rxbuf(adev, hostdesc->data);
+				acx_process_rxbuf(adev, hostdesc->data, NULL);
 			}
 		} else
 			log(L_ANY, "rx reclaim only!\n");
@@ -1145,7 +1400,9 @@ void acxmem_process_rxdesc(acx_device_t *adev)
 		CLEAR_BIT (Ctl_8, DESC_CTL_HOSTOWN);
 		SET_BIT (Ctl_8, DESC_CTL_HOSTDONE);
 		SET_BIT (Ctl_8, DESC_CTL_RECLAIM);
-		write_slavemem8(adev, (uintptr_t) &rxdesc->Ctl_8, Ctl_8);
+		acxmem_desc_wc_write8(adev, &wc,
+				offsetof(rxacxdesc_t, Ctl_8), Ctl_8);
+		acxmem_desc_wc_commit(adev, &wc, offsetof(rxacxdesc_t, Ctl_8));
 
 		/*
 		 * Now tell the ACX we've finished with the receive
@@ -1157,13 +1414,21 @@ void acxmem_process_rxdesc(acx_device_t *adev)
 		hostdesc = &adev->hw_rx_queue.hostdescinfo.start[tail];
 		rxdesc = &adev->hw_rx_queue.acxdescinfo.start[tail];
 
-		Ctl_8 = hostdesc->hd.Ctl_16 = read_slavemem8(adev, (uintptr_t) &(rxdesc->Ctl_8));
+		acxmem_desc_wc_init(&wc, (uintptr_t) rxdesc);
+		Ctl_8 = hostdesc->hd.Ctl_16 = acxmem_desc_wc_read8(adev, &wc,
+					offsetof(rxacxdesc_t, Ctl_8));
 
 		/* if next descriptor is empty, then bail out */
 		if (!(Ctl_8 & DESC_CTL_HOSTOWN) || !(Ctl_8 & DESC_CTL_ACXDONE))
 			break;
 
-		tail = (tail + 1) % RX_CNT;
+		/* budget used up: leave the rest for the next poll */
+		if (budget && ++done >= budget) {
+			adev->rx_poll_pending = 1;
+			break;
+		}
+
+		tail = (tail + 1) & adev->rx_mask;
 	}
 	end:
 		adev->hw_rx_queue.tail = tail;
@@ -1182,13 +1447,56 @@ static int acxmem_get_txbuf_space_needed(acx_device_t *adev,
 	return (blocks_needed);
 }
 
+/*
+ * Host mirror of the txbuf block chains
+ *
+ * Each txbuf block on the acx starts with a word linking to the next
+ * block, see acxmem_init_acx_txbuf(). adev->acx_txbuf_blk[] keeps the
+ * same links in host memory, so allocation and reclaim never walk
+ * them in slave memory. The links of the free list on the acx stay
+ * valid as they are, only its last block carries the end mark. So
+ * allocating a chain just marks its last block as the end, and
+ * reclaiming one links its last block to the free list: one slave
+ * memory write each.
+ */
+#define ACXMEM_TXBUF_END	0xffff
+#define ACXMEM_TXBUF_END_MARK	0x02000000
+
+static inline u32 acxmem_txbuf_addr(acx_device_t *adev, unsigned int blk)
+{
+	return adev->acx_txbuf_start + blk * adev->memblocksize;
+}
+
+static inline unsigned int acxmem_txbuf_index(acx_device_t *adev, u32 addr)
+{
+	return (addr - adev->acx_txbuf_start) / adev->memblocksize;
+}
+
+/* The block list as laid out by acxmem_init_acx_txbuf() */
+static void acxmem_txbuf_mirror_reset(acx_device_t *adev)
+{
+	struct acxmem_txbuf_blk *blk = adev->acx_txbuf_blk;
+	int i;
+
+	if (!blk)
+		return;
+
+	for (i = 0; i < adev->acx_txbuf_numblocks; i++) {
+		blk[i].next = i + 1;
+		blk[i].count = 0;
+	}
+	if (i)
+		blk[i - 1].next = ACXMEM_TXBUF_END;
+}
+
 /*
  * Return an acx pointer to the next transmit data block.
  */
 u32 acxmem_allocate_acx_txbuf_space(acx_device_t *adev, int count)
 {
-	u32 block, next, last_block;
-	int blocks_needed;
+	struct acxmem_txbuf_blk *blk = adev->acx_txbuf_blk;
+	unsigned int first, last;
+	int blocks_needed, i;
 
 	/*
 	 * Take 4 off the memory block size to account for the
@@ -1196,56 +1504,38 @@ u32 acxmem_allocate_acx_txbuf_space(acx_device_t *adev, int count)
 	 */
 	blocks_needed = acxmem_get_txbuf_space_needed(adev, count);
 
-	if (blocks_needed <= adev->acx_txbuf_blocks_free) {
-		/*
-		 * Take blocks at the head of the free list.
-		 */
-		last_block = block = adev->acx_txbuf_free;
-
-		/*
-		 * Follow block pointers through the requested number
-		 * of blocks both to find the new head of the free
-		 * list and to set the flags for the blocks
-		 * appropriately.
-		 */
-		while (blocks_needed--) {
-			/*
-			 * Keep track of the last block of the allocation
-			 */
-			last_block = adev->acx_txbuf_free;
+	if (!blocks_needed || blocks_needed > adev->acx_txbuf_blocks_free)
+		return 0;
 
-			/*
-			 * Make sure the end control flag is not set.
-			 */
-			next = read_slavemem32(adev, adev->acx_txbuf_free) & 0x7ffff;
-			write_slavemem32(adev, adev->acx_txbuf_free, next);
-
-			/*
-			 * Update the new head of the free list
-			 */
-			adev->acx_txbuf_free = next << 5;
-			adev->acx_txbuf_blocks_free--;
+	/*
+	 * Take blocks at the head of the free list, their links on
+	 * the acx are already in place.
+	 */
+	first = last = acxmem_txbuf_index(adev, adev->acx_txbuf_free);
+	for (i = 1; i < blocks_needed; i++)
+		last = blk[last].next;
 
-		}
+	blk[first].last = last;
+	blk[first].count = blocks_needed;
+	adev->acx_txbuf_blocks_free -= blocks_needed;
 
-		/*
-		 * Flag the last block both by clearing out the next
-		 * pointer and marking the control field.
-		 */
-		write_slavemem32(adev, last_block, 0x02000000);
+	/*
+	 * Flag the last block both by clearing out the next
+	 * pointer and marking the control field.
+	 */
+	write_slavemem32(adev, acxmem_txbuf_addr(adev, last),
+			ACXMEM_TXBUF_END_MARK);
 
-		/*
-		 * If we're out of buffers make sure the free list
-		 * pointer is NULL
-		 */
-		if (!adev->acx_txbuf_blocks_free) {
-			adev->acx_txbuf_free = 0;
-		}
-	} else {
-		block = 0;
-	}
+	/*
+	 * Update the new head of the free list. If we're out of
+	 * buffers make sure the free list pointer is NULL
+	 */
+	if (adev->acx_txbuf_blocks_free)
+		adev->acx_txbuf_free = acxmem_txbuf_addr(adev, blk[last].next);
+	else
+		adev->acx_txbuf_free = 0;
 
-	return block;
+	return acxmem_txbuf_addr(adev, first);
 }
 
 /*
@@ -1305,6 +1595,7 @@ void acxmem_dealloc_tx(acx_device_t *adev, tx_t *tx_opaque) {
  /* OW TODO Align with pci.c */
 tx_t *acxmem_alloc_tx(acx_device_t *adev, unsigned int len) {
 	struct txacxdesc *txdesc;
+	struct acxmem_desc_wc wc;
 	unsigned head;
 	u8 ctl8;
 	static int txattempts = 0;
@@ -1371,7 +1662,8 @@ tx_t *acxmem_alloc_tx(acx_device_t *adev, unsigned int len) {
 			"len=%i, blocks_needed=%i, acx_txbuf_blocks_free=%i: "
 			"Stopping queue.\n",
 			len, blocks_needed, adev->acx_txbuf_blocks_free);
-		acx_stop_queue(adev->hw, NULL);
+		/* acx_tx_queue_go() stops the queue on NULL */
+		adev->mem_tx_starved++;
 		goto end;
 	}
 
@@ -1380,7 +1672,8 @@ tx_t *acxmem_alloc_tx(acx_device_t *adev, unsigned int len) {
 	 * txdesc points to ACX memory
 	 */
 	txdesc = acx_get_txacxdesc(adev, head, 0);
-	ctl8 = read_slavemem8(adev, (uintptr_t) &(txdesc->Ctl_8));
+	acxmem_desc_wc_init(&wc, (uintptr_t) txdesc);
+	ctl8 = acxmem_desc_wc_read8(adev, &wc, offsetof(txacxdesc_t, Ctl_8));
 
 	/*
 	 * If we don't own the buffer (HOSTOWN) it is certainly not
@@ -1403,13 +1696,15 @@ tx_t *acxmem_alloc_tx(acx_device_t *adev, unsigned int len) {
 	}
 
 	/* Needed in case txdesc won't be eventually submitted for tx */
-	write_slavemem8(adev, (uintptr_t) &(txdesc->Ctl_8), DESC_CTL_ACXDONE_HOSTOWN);
+	acxmem_desc_wc_write8(adev, &wc, offsetof(txacxdesc_t, Ctl_8),
+			DESC_CTL_ACXDONE_HOSTOWN);
+	acxmem_desc_wc_commit(adev, &wc, offsetof(txacxdesc_t, Ctl_8));
 
 	adev->hw_tx_queue[0].free--;
 	log(L_BUFT, "tx: got desc %u, %u remain\n", head, adev->hw_tx_queue[0].free);
 
 	/* returning current descriptor, so advance to next free one */
-	adev->hw_tx_queue[0].head = (head + 1) % TX_CNT;
+	adev->hw_tx_queue[0].head = (head + 1) & adev->tx_mask;
 
 	end:
 
@@ -1429,43 +1724,42 @@ tx_t *acxmem_alloc_tx(acx_device_t *adev, unsigned int len) {
  */
 void acxmem_reclaim_acx_txbuf_space(acx_device_t *adev, u32 blockptr)
 {
-	u32 cur, last, next;
-
-	if ((blockptr >= adev->acx_txbuf_start) &&
-		(blockptr <= adev->acx_txbuf_start +
-		(adev->acx_txbuf_numblocks - 1)	* adev->memblocksize)) {
-		cur = blockptr;
-		do {
-			last = cur;
-			next = read_slavemem32(adev, cur);
-
-			/*
-			 * Advance to the next block in this allocation
-			 */
-			cur = (next & 0x7ffff) << 5;
-
-			/*
-			 * This block now counts as free.
-			 */
-			adev->acx_txbuf_blocks_free++;
-		} while (!(next & 0x02000000));
-
-		/*
-		 * last now points to the last block of that
-		 * allocation.  Update the pointer in that block to
-		 * point to the free list and reset the free list to
-		 * the first block of the free call.  If there were no
-		 * free blocks, make sure the new end of the list
-		 * marks itself as truly the end.
-		 */
-		if (adev->acx_txbuf_free) {
-			write_slavemem32(adev, last, adev->acx_txbuf_free >> 5);
-		} else {
-			write_slavemem32(adev, last, 0x02000000);
-		}
-		adev->acx_txbuf_free = blockptr;
+	struct acxmem_txbuf_blk *blk = adev->acx_txbuf_blk;
+	unsigned int first, last;
+
+	if (!blk || (blockptr < adev->acx_txbuf_start) ||
+		(blockptr > adev->acx_txbuf_start +
+		(adev->acx_txbuf_numblocks - 1)	* adev->memblocksize))
+		return;
+
+	first = acxmem_txbuf_index(adev, blockptr);
+	if (unlikely(!blk[first].count
+			|| acxmem_txbuf_addr(adev, first) != blockptr)) {
+		log(L_ANY, "txbuf: 0x%04x is no allocated chain, "
+			"not reclaimed\n", blockptr);
+		return;
 	}
+	last = blk[first].last;
 
+	/*
+	 * Update the pointer in the last block of that allocation to
+	 * point to the free list and reset the free list to the
+	 * first block of the free call.  If there were no free
+	 * blocks, make sure the new end of the list marks itself as
+	 * truly the end.
+	 */
+	if (adev->acx_txbuf_free) {
+		blk[last].next = acxmem_txbuf_index(adev, adev->acx_txbuf_free);
+		write_slavemem32(adev, acxmem_txbuf_addr(adev, last),
+				adev->acx_txbuf_free >> 5);
+	} else {
+		blk[last].next = ACXMEM_TXBUF_END;
+		write_slavemem32(adev, acxmem_txbuf_addr(adev, last),
+				ACXMEM_TXBUF_END_MARK);
+	}
+	adev->acx_txbuf_free = blockptr;
+	adev->acx_txbuf_blocks_free += blk[first].count;
+	blk[first].count = 0;
 }
 
 
@@ -1484,6 +1778,20 @@ void acxmem_init_acx_txbuf(acx_device_t *adev)
 	 * rest of the bookeeping.
 	 */
 
+	if (adev->acx_txbuf_numblocks > adev->acx_txbuf_blk_cap) {
+		kfree(adev->acx_txbuf_blk);
+		adev->acx_txbuf_blk_cap = 0;
+		adev->acx_txbuf_blk = kcalloc(adev->acx_txbuf_numblocks,
+					sizeof(*adev->acx_txbuf_blk), GFP_KERNEL);
+		if (!adev->acx_txbuf_blk) {
+			pr_acxmem("%s: no memory for the txbuf mirror\n",
+				wiphy_name(adev->hw->wiphy));
+			adev->acx_txbuf_numblocks = 0;
+		} else
+			adev->acx_txbuf_blk_cap = adev->acx_txbuf_numblocks;
+	}
+	acxmem_txbuf_mirror_reset(adev);
+
 	adev->acx_txbuf_free = adev->acx_txbuf_start;
 	adev->acx_txbuf_blocks_free = adev->acx_txbuf_numblocks;
 
@@ -1519,6 +1827,7 @@ void acxmem_init_acx_txbuf2(acx_device_t *adev)
 		}
 		adr = next_adr;
 	}
+	acxmem_txbuf_mirror_reset(adev);
 
 	adev->acx_txbuf_free = adev->acx_txbuf_start;
 	adev->acx_txbuf_blocks_free = adev->acx_txbuf_numblocks;
@@ -1536,7 +1845,7 @@ acxmem_get_txhostdesc(acx_device_t *adev, txacxdesc_t* txdesc)
 		return NULL;
 	}
 	index /= adev->tx.desc_size;
-	if (unlikely(ACX_DEBUG && (index >= TX_CNT))) {
+	if (unlikely(ACX_DEBUG && (index >= adev->tx_cnt))) {
 		pr_info("bad txdesc ptr %p\n", txdesc);
 		return NULL;
 	}
@@ -1690,7 +1999,7 @@ static irqreturn_t acxmem_interrupt(int irq, void *dev_id)
 		 */
 		if (irqtype & HOST_INT_RX_DATA) {
 			log(L_IRQ, "got Rx_Data IRQ\n");
-			acxmem_process_rxdesc(adev);
+			acxmem_process_rxdesc(adev, 0);
 		}
 
 		if (irqtype & HOST_INT_TX_COMPLETE) {
@@ -2053,7 +2362,7 @@ int acx111pci_ioctl_info(struct ieee80211_hw *hw,
 
 	/* loop over complete receive pool */
 	if (rxdesc)
-		for (i = 0; i < RX_CNT; i++) {
+		for (i = 0; i < adev->rx_cnt; i++) {
 			pr_acx("\ndump internal rxdesc %d:\n"
 				"mem pos %p\n"
 				"next 0x%X\n"
@@ -2076,7 +2385,7 @@ int acx111pci_ioctl_info(struct ieee80211_hw *hw,
 
 		/* loop over complete receive pool */
 		if (rxhostdesc)
-		for (i = 0; i < RX_CNT; i++) {
+		for (i = 0; i < adev->rx_cnt; i++) {
 			pr_acx("\ndump host rxdesc %d:\n"
 				"mem pos %p\n"
 				"buffer mem pos 0x%X\n"
@@ -2101,7 +2410,7 @@ int acx111pci_ioctl_info(struct ieee80211_hw *hw,
 
 		/* loop over complete transmit pool */
 		if (txdesc)
-		for (i = 0; i < TX_CNT; i++) {
+		for (i = 0; i < adev->tx_cnt; i++) {
 			pr_acx("\ndump internal txdesc %d:\n"
 				"size 0x%X\n"
 				"mem pos %p\n"
@@ -2133,7 +2442,7 @@ int acx111pci_ioctl_info(struct ieee80211_hw *hw,
 
 		/* loop over complete host send pool */
 		if (txhostdesc)
-		for (i = 0; i < TX_CNT * 2; i++) {
+		for (i = 0; i < adev->tx_cnt * 2; i++) {
 			pr_acx("\ndump host txdesc %d:\n"
 				"mem pos %p\n"
 				"buffer mem pos 0x%X\n"
@@ -2516,8 +2825,8 @@ static int acxmem_e_suspend(struct platform_device *pdev,
 
 	acx_sem_lock(adev);
 
+	acx_cfg_snapshot(adev);
 	ieee80211_unregister_hw(hw); /* this one cannot sleep */
-	acxmem_s_down(hw);
 	/* down() does not set it to 0xffff, but here we really want that */
 	write_reg16(adev, IO_ACX_IRQ_MASK, 0xffff);
 	write_reg16(adev, IO_ACX_FEMR, 0x0);
@@ -2541,6 +2850,7 @@ static int acxmem_e_resume(struct platform_device *pdev)
 	struct ieee80211_hw *hw = (struct ieee80211_hw *)
 		platform_get_drvdata(pdev);
 	acx_device_t *adev;
+	ktime_t t0 = ktime_get(), t1;
 
 
 
@@ -2563,32 +2873,22 @@ static int acxmem_e_resume(struct platform_device *pdev)
 	 * hwdata->start_hw();
 	 */
 
-	acxmem_complete_hw_reset(adev);
-
-	/*
-	 * done by acx_set_defaults for initial startup
-	 */
-	acx_set_interrupt_mask(adev);
-
-	pr_acx("rsm: bringing up interface\n");
-	SET_BIT (adev->set_mask, GETSET_ALL);
-	acx_up(hw);
-	pr_acx("rsm: acx up done\n");
-
-	/* now even reload all card parameters as they were before
-	 * suspend, and possibly be back in the network again already
-	 * :-)
-	 */
-	/* - most settings updated in acx_up() */
-	if (ACX_STATE_IFACE_UP & adev->dev_state_mask) {
-		adev->set_mask = GETSET_ALL;
-		acx_update_card_settings(adev);
-		pr_acx("rsm: settings updated\n");
-	}
+	/* fw upload, init_mac and the settings as they were before
+	 * suspend, see acx_resume_hw() */
+	if (OK != acx_resume_hw(adev))
+		goto end_unlock;
+	pr_acx("rsm: device reset and settings restored\n");
 
+	t1 = ktime_get();
 	ieee80211_register_hw(hw);
+	adev->resume_ns[ACX_RESUME_REGISTER] =
+		ktime_to_ns(ktime_sub(ktime_get(), t1));
+	adev->resume_ns[ACX_RESUME_TOTAL] =
+		ktime_to_ns(ktime_sub(ktime_get(), t0));
 	pr_acx("rsm: device attached\n");
 
+end_unlock:
+
 	acx_sem_unlock(adev);
 
 
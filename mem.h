@@ -32,6 +32,8 @@ void acxmem_reset_mac(acx_device_t *adev);
 int acxmem_patch_around_bad_spots(acx_device_t *adev);
 
 int acxmem_dbgfs_diag_output(struct seq_file *file, acx_device_t *adev);
+int acxmem_dbgfs_bench_output(struct seq_file *file, acx_device_t *adev);
+int acxmem_dbgfs_txbuf_output(struct seq_file *file, acx_device_t *adev);
 
 tx_t *acxmem_alloc_tx(acx_device_t *adev, unsigned int len);
 void acxmem_dealloc_tx(acx_device_t *adev, tx_t *tx_opaque);
@@ -42,7 +44,7 @@ u32 acxmem_allocate_acx_txbuf_space(acx_device_t *adev, int count);
 void acxmem_init_acx_txbuf(acx_device_t *adev);
 void acxmem_init_acx_txbuf2(acx_device_t *adev);
 
-void acxmem_process_rxdesc(acx_device_t *adev);
+void acxmem_process_rxdesc(acx_device_t *adev, unsigned int budget);
 
 int __init acxmem_init_module(void);
 void __exit acxmem_cleanup_module(void);
@@ -79,6 +81,14 @@ static inline int acxmem_dbgfs_diag_output(struct seq_file *file,
 		acx_device_t *adev)
 { return 0; }
 
+static inline int acxmem_dbgfs_bench_output(struct seq_file *file,
+		acx_device_t *adev)
+{ return 0; }
+
+static inline int acxmem_dbgfs_txbuf_output(struct seq_file *file,
+		acx_device_t *adev)
+{ return 0; }
+
 static inline tx_t *acxmem_alloc_tx(acx_device_t *adev, unsigned int len)
 { return (tx_t*) NULL; }
 
@@ -106,7 +116,8 @@ static inline void __exit acxmem_cleanup_module(void)
 
 static inline void acxmem_init_mboxes(acx_device_t *adev) { }
 
-static inline void acxmem_process_rxdesc(acx_device_t *adev) { };
+static inline void acxmem_process_rxdesc(acx_device_t *adev,
+					unsigned int budget) { };
 
 #endif /* defined(CONFIG_ACX_MAC80211_MEM) */
 #endif /* _MEM_H_ */
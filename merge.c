@@ -42,6 +42,7 @@
 #include <linux/workqueue.h>
 #include <linux/nl80211.h>
 #include <linux/dma-mapping.h>
+#include <linux/ktime.h>
 
 #include <net/iw_handler.h>
 #include <net/mac80211.h>
@@ -69,6 +70,9 @@
 
 #define RX_BUFFER_SIZE (sizeof(rxbuffer_t) + 32)
 
+static void acx_tx_unmap_skb(acx_device_t *adev, txhostdesc_t *hostdesc1,
+			int queue_id);
+
 /* from mem.c:98 */
 #define FW_NO_AUTO_INCREMENT 1
 
@@ -116,12 +120,30 @@ irqreturn_t acx_interrupt(int irq, void *dev_id)
 		goto none;
 	}
 
+	adev->irq_count++;
+
+	/* PCI: command completion is signalled right here. The
+	 * issuer waits holding the sem, so acx_irq_work() can't run
+	 * before the command is done. CMD_COMPLETE is also left
+	 * unmasked below, for the commands issued until then. */
+	if (IS_PCI(adev) && (irqmasked & HOST_INT_CMD_COMPLETE)) {
+		write_reg16(adev, IO_ACX_IRQ_ACK, HOST_INT_CMD_COMPLETE);
+		complete(&adev->cmd_done);
+		irqmasked &= ~HOST_INT_CMD_COMPLETE;
+		if (!irqmasked) {
+			write_flush(adev);
+			goto handled;
+		}
+	}
+
 	/* Mask all irqs, until we handle them. We will unmask them
 	 * later in the tasklet. */
-	write_reg16(adev, IO_ACX_IRQ_MASK, HOST_INT_MASK_ALL);
+	write_reg16(adev, IO_ACX_IRQ_MASK, IS_PCI(adev) ?
+		HOST_INT_MASK_ALL & ~HOST_INT_CMD_COMPLETE : HOST_INT_MASK_ALL);
 	write_flush(adev);
 	acx_schedule_task(adev, 0);
 
+handled:
 	spin_unlock_irqrestore(&adev->spinlock, flags);
 
 	return IRQ_HANDLED;
@@ -138,29 +160,23 @@ int acx_upload_radio(acx_device_t *adev)
 	int res = NOT_OK;
 	int try;
 	u32 offset;
-	acxmem_lock_flags;
+	ktime_t t0;
 
 	firmware_image_t *radio_image=adev->radio_image;
 
 	if (!radio_image)
 		return OK;
 
+	t0 = ktime_get();
+
 	acx_interrogate(adev, &mm, ACX1xx_IE_MEMORY_MAP);
 	offset = le32_to_cpu(mm.CodeEnd);
 
 	acx_issue_cmd(adev, ACX1xx_CMD_SLEEP, NULL, 0);
 
 	for (try = 1; try <= 5; try++) {
-		acxmem_lock();
-		res = acx_write_fw(adev, radio_image, offset);
-		log(L_DEBUG|L_INIT, "acx_write_fw (radio): %d\n", res);
-
-		if (OK == res) {
-			res = acx_validate_fw(adev, radio_image, offset);
-			log(L_DEBUG|L_INIT, "acx_validate_fw (radio): %d\n", res);
-		}
-		acxmem_unlock();
-
+		res = acx_upload_fw_try(adev, radio_image, offset, try, 0,
+					"radio");
 		if (OK == res)
 			break;
 		pr_acx("radio firmware upload attempt #%d FAILED, "
@@ -184,6 +200,7 @@ int acx_upload_radio(acx_device_t *adev)
 	res = acx_interrogate(adev, &mm, ACX1xx_IE_MEMORY_MAP);
 
 fail:
+	adev->boot_ns[ACX_BOOT_RADIO] = ktime_to_ns(ktime_sub(ktime_get(), t0));
 
 	return res;
 }
@@ -248,7 +265,7 @@ static int acx_create_rx_host_desc_queue(acx_device_t *adev)
 
 	/* allocate the RX host descriptor queue pool, if not already done */
 	if (!adev->hw_rx_queue.hostdescinfo.start) {
-		adev->hw_rx_queue.hostdescinfo.size = RX_CNT * sizeof(*hostdesc);
+		adev->hw_rx_queue.hostdescinfo.size = adev->rx_cnt * sizeof(*hostdesc);
 		rc = acx_allocate(adev, adev->hw_rx_queue.hostdescinfo.size,
 			&adev->hw_rx_queue.hostdescinfo.phy,
 			(void**) &adev->hw_rx_queue.hostdescinfo.start, "rxhostdesc_start");
@@ -265,7 +282,7 @@ static int acx_create_rx_host_desc_queue(acx_device_t *adev)
 	/* allocate Rx buffer pool which will be used by the acx
 	 * to store the whole content of the received frames in it */
 	if (!adev->hw_rx_queue.bufinfo.start) {
-		adev->hw_rx_queue.bufinfo.size = RX_CNT * RX_BUFFER_SIZE;
+		adev->hw_rx_queue.bufinfo.size = adev->rx_cnt * RX_BUFFER_SIZE;
 		rc = acx_allocate(adev, adev->hw_rx_queue.bufinfo.size,
 			&adev->hw_rx_queue.bufinfo.phy,
 			&adev->hw_rx_queue.bufinfo.start, "rxbuf_start");
@@ -281,9 +298,18 @@ static int acx_create_rx_host_desc_queue(acx_device_t *adev)
 	/* don't make any popular C programming pointer arithmetic
 	 * mistakes here, otherwise I'll kill you...  (and don't dare
 	 * asking me why I'm warning you about that...) */
-	for (i = 0; i < RX_CNT; i++) {
-		hostdesc->data = rxbuf;
-		hostdesc->hd.data_phy = cpu2acx(rxbuf_phy);
+	for (i = 0; i < adev->rx_cnt; i++) {
+		/* PCI zero-copy rx: keep or attach a mapped skb, use the
+		 * coherent rxbuf slot if that fails */
+		if (IS_PCI(adev) && !hostdesc->skb && acx_rx_zerocopy)
+			acxpci_rx_refill(adev, hostdesc);
+		if (hostdesc->skb) {
+			hostdesc->data = (rxbuffer_t *) hostdesc->skb->data;
+			hostdesc->hd.data_phy = cpu2acx(hostdesc->skb_phy);
+		} else {
+			hostdesc->data = rxbuf;
+			hostdesc->hd.data_phy = cpu2acx(rxbuf_phy);
+		}
 		hostdesc->hd.length = cpu_to_le16(RX_BUFFER_SIZE);
 		CLEAR_BIT(hostdesc->hd.Ctl_16, cpu_to_le16(DESC_CTL_HOSTOWN));
 		rxbuf++;
@@ -314,7 +340,7 @@ static int acx_create_tx_host_desc_queue(acx_device_t *adev, struct hw_tx_queue
 
 	/* allocate TX buffer, if not already done */
 	if (!tx->bufinfo.start) {
-		tx->bufinfo.size = TX_CNT * WLAN_A4FR_MAXLEN_WEP_FCS;
+		tx->bufinfo.size = adev->tx_cnt * WLAN_A4FR_MAXLEN_WEP_FCS;
 		rc = acx_allocate(adev, tx->bufinfo.size, &tx->bufinfo.phy,
 			&tx->bufinfo.start, "txbuf_start");
 		if (rc)
@@ -323,7 +349,7 @@ static int acx_create_tx_host_desc_queue(acx_device_t *adev, struct hw_tx_queue
 
 	/* allocate the TX host descriptor queue pool */
 	if (!tx->hostdescinfo.start) {
-		tx->hostdescinfo.size = TX_CNT * 2 * sizeof(*hostdesc);
+		tx->hostdescinfo.size = adev->tx_cnt * 2 * sizeof(*hostdesc);
 		rc = acx_allocate(adev, tx->hostdescinfo.size, &tx->hostdescinfo.phy,
 			(void**) &tx->hostdescinfo.start, "txhostdesc_start");
 		if (rc)
@@ -355,7 +381,7 @@ static int acx_create_tx_host_desc_queue(acx_device_t *adev, struct hw_tx_queue
  * WG311v2 is even more bogus, doesn't work.  Keeping this code
  * (#ifdef'ed out) for documentational purposes.
  */
-	for (i = 0; i < TX_CNT * 2; i++) {
+	for (i = 0; i < adev->tx_cnt * 2; i++) {
 		hostdesc_phy += sizeof(*hostdesc);
 		if (!(i & 1)) {
 			hostdesc->hd.data_phy = cpu2acx(txbuf_phy);
@@ -390,7 +416,7 @@ static int acx_create_tx_host_desc_queue(acx_device_t *adev, struct hw_tx_queue
 	/* We initialize two hostdescs so that they point to adjacent
 	 * memory areas. Thus txbuf is really just a contiguous memory
 	 * area */
-	for (i = 0; i < TX_CNT * 2; i++) {
+	for (i = 0; i < adev->tx_cnt * 2; i++) {
 		hostdesc_phy += sizeof(*hostdesc);
 
 		hostdesc->hd.data_phy = cpu2acx(txbuf_phy);
@@ -466,7 +492,7 @@ static void acx_create_rx_desc_queue(acx_device_t *adev, u32 rx_queue_start)
 
 		rxdesc = adev->hw_rx_queue.acxdescinfo.start;
 
-		for (i = 0; i < RX_CNT; i++) {
+		for (i = 0; i < adev->rx_cnt; i++) {
 			log(L_DEBUG, "rx descriptor %d @ 0x%p\n", i, rxdesc);
 
 			if (IS_PCI(adev))
@@ -484,7 +510,7 @@ static void acx_create_rx_desc_queue(acx_device_t *adev, u32 rx_queue_start)
 		/* rxdesc_start should be right AFTER Tx pool */
 		adev->hw_rx_queue.acxdescinfo.start = (rxacxdesc_t *)
 			((u8 *) adev->hw_tx_queue[0].acxdescinfo.start
-				+ (TX_CNT * sizeof(txacxdesc_t)));
+				+ (adev->tx_cnt * sizeof(txacxdesc_t)));
 
 		/* NB: sizeof(txdesc_t) above is valid because we know
 		 * we are in if (acx100) block. Beware of cut-n-pasting
@@ -492,11 +518,11 @@ static void acx_create_rx_desc_queue(acx_device_t *adev, u32 rx_queue_start)
 
 		if (IS_PCI(adev))
 			memset(adev->hw_rx_queue.acxdescinfo.start, 0,
-				RX_CNT * sizeof(*rxdesc));
+				adev->rx_cnt * sizeof(*rxdesc));
 		else { // IS_MEM
 			mem_offs = (uintptr_t) adev->hw_rx_queue.acxdescinfo.start;
 			while (mem_offs < (uintptr_t) adev->hw_rx_queue.acxdescinfo.start
-				+ (RX_CNT * sizeof(*rxdesc))) {
+				+ (adev->rx_cnt * sizeof(*rxdesc))) {
 				write_slavemem32(adev, mem_offs, 0);
 				mem_offs += 4;
 			}
@@ -504,7 +530,7 @@ static void acx_create_rx_desc_queue(acx_device_t *adev, u32 rx_queue_start)
 		/* loop over whole receive pool */
 		rxdesc = adev->hw_rx_queue.acxdescinfo.start;
 		mem_offs = rx_queue_start;
-		for (i = 0; i < RX_CNT; i++) {
+		for (i = 0; i < adev->rx_cnt; i++) {
 			log(L_DEBUG, "rx descriptor @ 0x%p\n", rxdesc);
 			/* point to next rxdesc */
 			if (IS_PCI(adev)){
@@ -571,7 +597,7 @@ static void acx_create_tx_desc_queue(acx_device_t *adev, u32 tx_queue_start, int
 
 	adev->hw_tx_queue[queue_id].head = 0;
 	adev->hw_tx_queue[queue_id].tail = 0;
-	adev->hw_tx_queue[queue_id].free = TX_CNT;
+	adev->hw_tx_queue[queue_id].free = adev->tx_cnt;
 
 	txdesc = tx->acxdescinfo.start;
 	if (IS_PCI(adev)) {
@@ -583,7 +609,7 @@ static void acx_create_tx_desc_queue(acx_device_t *adev, u32 tx_queue_start, int
 		/* ACX111 has a preinitialized Tx buffer! */
 		/* loop over whole send pool */
 		/* FIXME: do we have to do the hostmemptr stuff here?? */
-		for (i = 0; i < TX_CNT; i++) {
+		for (i = 0; i < adev->tx_cnt; i++) {
 
 			txdesc->Ctl_8 = DESC_CTL_HOSTOWN;
 			/* reserve two (hdr desc and payload desc) */
@@ -600,20 +626,20 @@ static void acx_create_tx_desc_queue(acx_device_t *adev, u32 tx_queue_start, int
 		 * acx100) */
 		if (IS_PCI(adev))
 			memset(tx->acxdescinfo.start, 0,
-				TX_CNT * sizeof(*txdesc));
+				adev->tx_cnt * sizeof(*txdesc));
 		else {
 			/* tx->desc_start refers to device memory,
 			  so we can't write directly to it. */
 			clr = (uintptr_t) tx->acxdescinfo.start;
 			while (clr < (uintptr_t) tx->acxdescinfo.start
-				+ (TX_CNT * sizeof(*txdesc))) {
+				+ (adev->tx_cnt * sizeof(*txdesc))) {
 				write_slavemem32(adev, clr, 0);
 				clr += 4;
 			}
 		}
 
 		/* loop over whole send pool */
-		for (i = 0; i < TX_CNT; i++) {
+		for (i = 0; i < adev->tx_cnt; i++) {
 			log(L_DEBUG, "configure card tx descriptor: 0x%p, "
 				"size: %zu\n", txdesc, tx->acxdescinfo.size);
 
@@ -703,9 +729,15 @@ void acx_create_desc_queues(acx_device_t *adev, u32 rx_queue_start,
  */
 void acx_free_desc_queues(acx_device_t *adev)
 {
-	int i;
+	int i, j;
 
 	for (i = 0; i < adev->num_hw_tx_queues; i++) {
+		/* release zero-copy mappings of frames still in flight */
+		if (IS_PCI(adev) && adev->hw_tx_queue[i].hostdescinfo.start)
+			for (j = 0; j < adev->tx_cnt; j++)
+				acx_tx_unmap_skb(adev,
+					&adev->hw_tx_queue[i].hostdescinfo.start[j * 2], i);
+
 		acx_free(adev, &adev->hw_tx_queue[i].hostdescinfo.size,
 		        (void**) &adev->hw_tx_queue[i].hostdescinfo.start,
 		        adev->hw_tx_queue[i].hostdescinfo.phy);
@@ -718,6 +750,9 @@ void acx_free_desc_queues(acx_device_t *adev)
 		adev->hw_tx_queue[i].acxdescinfo.size = 0;
 	}
 
+	if (IS_PCI(adev))
+		acxpci_rx_free_skbs(adev);
+
 	acx_free(adev, &adev->hw_rx_queue.hostdescinfo.size,
 	        (void**) &adev->hw_rx_queue.hostdescinfo.start,
 	        adev->hw_rx_queue.hostdescinfo.phy);
@@ -771,7 +806,7 @@ void acx_log_rxbuffer(const acx_device_t *adev)
 	if (unlikely(!rxhostdesc))
 		return;
 
-	for (i = 0; i < RX_CNT; i++) {
+	for (i = 0; i < adev->rx_cnt; i++) {
 		if ((rxhostdesc->hd.Ctl_16 & cpu_to_le16(DESC_CTL_HOSTOWN))
 		    && (rxhostdesc->hd.Status & cpu_to_le32(DESC_STATUS_FULL)))
 			pr_acx("rx: buf %d full\n", i);
@@ -790,7 +825,7 @@ void acx_log_txbuffer(acx_device_t *adev, int queue_id)
 			return;
 
 	pr_acx("tx[%d]: desc->Ctl8's: ", queue_id);
-	for (i = 0; i < TX_CNT; i++) {
+	for (i = 0; i < adev->tx_cnt; i++) {
 		Ctl_8 = (IS_MEM(adev))
 			? read_slavemem8(adev, (uintptr_t) &(txdesc->Ctl_8))
 			: txdesc->Ctl_8;
@@ -1263,6 +1298,129 @@ int acx_validate_fw(acx_device_t *adev, const firmware_image_t *fw_image,
 	return result;
 }
 
+/*
+ * Fast firmware upload
+ *
+ * acx_write_fw() sets the slave address for every word and flushes
+ * after each write (and on MEM reads every word back), and
+ * acx_validate_fw() sets the address again for every word it reads.
+ * The fast variants set the address once and stream the words in
+ * auto-increment mode, with a single flush at the end. Verification
+ * is one streamed read pass, which checks the words and the image
+ * checksum.
+ */
+static void acx_fw_stream_start(acx_device_t *adev, u32 offset)
+{
+	write_reg32(adev, IO_ACX_SLV_MEM_CTL, 1); /* use autoincrement mode */
+	write_reg32(adev, IO_ACX_SLV_MEM_ADDR, offset); /* configure start address */
+	write_flush(adev);
+	if (IS_MEM(adev))
+		udelay(10);
+}
+
+static int acx_write_fw_fast(acx_device_t *adev,
+			const firmware_image_t *fw_image, u32 offset)
+{
+	int len, size;
+	u32 sum;
+	/* we skip the first four bytes which contain the control sum */
+	const u8 *p = (u8*) fw_image + 4;
+
+	/* start the image checksum by adding the image size value */
+	sum = p[0] + p[1] + p[2] + p[3];
+	p += 4;
+
+	acx_fw_stream_start(adev, offset);
+
+	size = le32_to_cpu(fw_image->size) & (~3);
+	for (len = 0; len < size; len += 4, p += 4) {
+		sum += p[0] + p[1] + p[2] + p[3];
+		write_reg32(adev, IO_ACX_SLV_MEM_DATA, be32_to_cpu(*(u32*)p));
+	}
+	write_flush(adev);
+
+	log(L_DEBUG, "firmware streamed, size:%d sum1:%x sum2:%x\n",
+		size, sum, le32_to_cpu(fw_image->chksum));
+
+	return (sum != le32_to_cpu(fw_image->chksum));
+}
+
+static int acx_validate_fw_fast(acx_device_t *adev,
+			const firmware_image_t *fw_image, u32 offset)
+{
+	u32 sum, v32, w32;
+	int len, size;
+	const u8 *p = (u8*) fw_image + 4;
+
+	sum = p[0] + p[1] + p[2] + p[3];
+	p += 4;
+
+	write_reg32(adev, IO_ACX_SLV_END_CTL, 0);
+	acx_fw_stream_start(adev, offset);
+
+	size = le32_to_cpu(fw_image->size) & (~3);
+	for (len = 0; len < size; len += 4, p += 4) {
+		v32 = be32_to_cpu(*(u32*)p);
+		w32 = read_reg32(adev, IO_ACX_SLV_MEM_DATA);
+		if (unlikely(w32 != v32)) {
+			pr_acx("firmware upload: data at offset %d doesn't "
+				"match (0x%08X vs. 0x%08X), fast mode\n",
+				len, v32, w32);
+			return NOT_OK;
+		}
+		sum += (u8) w32
+			+ (u8) (w32 >> 8)
+			+ (u8) (w32 >> 16)
+			+ (u8) (w32 >> 24);
+	}
+
+	if (sum != le32_to_cpu(fw_image->chksum)) {
+		pr_acx("firmware upload: checksums don't match, fast mode\n");
+		return NOT_OK;
+	}
+
+	return OK;
+}
+
+/*
+ * One upload try. The first goes in fast mode if the fwfast param
+ * allows, retries word by word. With timed the write and verify
+ * times go to adev->boot_ns[].
+ */
+static int acx_upload_fw_try(acx_device_t *adev,
+			const firmware_image_t *fw_image, u32 offset,
+			int try, int timed, const char *what)
+{
+	int fast = acx_fw_fast && try == 1;
+	ktime_t t0;
+	int res;
+	acxmem_lock_flags;
+
+	acxmem_lock();
+	t0 = ktime_get();
+	res = fast ? acx_write_fw_fast(adev, fw_image, offset)
+		: acx_write_fw(adev, fw_image, offset);
+	if (timed)
+		adev->boot_ns[ACX_BOOT_FW_WRITE] =
+			ktime_to_ns(ktime_sub(ktime_get(), t0));
+	log(L_DEBUG|L_INIT, "acx_write_fw (%s%s): %d\n",
+		what, fast ? ", fast" : "", res);
+
+	if (OK == res) {
+		t0 = ktime_get();
+		res = fast ? acx_validate_fw_fast(adev, fw_image, offset)
+			: acx_validate_fw(adev, fw_image, offset);
+		if (timed)
+			adev->boot_ns[ACX_BOOT_FW_VERIFY] =
+				ktime_to_ns(ktime_sub(ktime_get(), t0));
+		log(L_DEBUG|L_INIT, "acx_validate_fw (%s%s): %d\n",
+			what, fast ? ", fast" : "", res);
+	}
+	acxmem_unlock();
+
+	return res;
+}
+
 static int _acx_upload_fw(acx_device_t *adev)
 {
 	int res = NOT_OK;
@@ -1270,21 +1428,13 @@ static int _acx_upload_fw(acx_device_t *adev)
 
 	firmware_image_t *fw_image = adev->fw_image;
 
-	acxmem_lock_flags;
-
 	for (try = 1; try <= 5; try++) {
 
-		acxmem_lock();
-		res = acx_write_fw(adev, fw_image, 0);
-		log(L_DEBUG|L_INIT, "acx_write_fw (main): %d\n", res);
-		if (OK == res) {
-			res = acx_validate_fw(adev, fw_image, 0);
-			log(L_DEBUG|L_INIT, "acx_validate_fw "
-					"(main): %d\n", res);
-		}
-		acxmem_unlock();
+		res = acx_upload_fw_try(adev, fw_image, 0, try, 1, "main");
 
 		if (OK == res) {
+			adev->fw_tries = try;
+			adev->fw_fast = acx_fw_fast && try == 1;
 			set_bit(ACX_FLAG_FW_LOADED, &adev->flags);
 			break;
 		}
@@ -1302,33 +1452,40 @@ static int _acx_upload_fw(acx_device_t *adev)
 
 int acx_free_firmware(acx_device_t *adev)
 {
-	if(adev->fw_image)
-		vfree(adev->fw_image);
+	acx_put_fw(adev->fw_image);
 	adev->fw_image = NULL;
 
-	if(adev->radio_image)
-		vfree(adev->radio_image);
+	acx_put_fw(adev->radio_image);
 	adev->radio_image = NULL;
 
 	return 0;
 }
 
-int acx_load_firmware(acx_device_t *adev, char *fw_image_filename, char *radio_image_filename)
+/*
+ * Takes references to the images in the firmware cache, see
+ * acx_get_fw(). With cached_only the filesystem isn't tried.
+ */
+int acx_load_firmware(acx_device_t *adev, char *fw_image_filename,
+		char *radio_image_filename, int cached_only)
 {
 	int res = 0;
 	u32 file_size;
 
-	log(L_ANY, "Required firmware: fw_image=\'%s\', radio_image=\'%s\'\n",
-	    fw_image_filename, radio_image_filename);
+	if (!cached_only)
+		log(L_ANY, "Required firmware: fw_image=\'%s\', "
+			"radio_image=\'%s\'\n",
+			fw_image_filename, radio_image_filename);
 
-	adev->fw_image = acx_read_fw(adev->bus_dev, fw_image_filename, &file_size);
+	adev->fw_image = acx_get_fw(adev->bus_dev, fw_image_filename,
+				&file_size, cached_only);
 	if (!adev->fw_image)
 		goto err;
 
 	if (!radio_image_filename)
 		goto end;
 
-	adev->radio_image = acx_read_fw(adev->bus_dev, radio_image_filename, &file_size);
+	adev->radio_image = acx_get_fw(adev->bus_dev, radio_image_filename,
+				&file_size, cached_only);
 	if (!adev->radio_image)
 		goto err;
 
@@ -1471,6 +1628,59 @@ static int acx_wait_cmd_status(acx_device_t *adev, unsigned cmd,
 	return 0;
 }
 
+/*
+ * Waiting for HOST_INT_CMD_COMPLETE
+ *
+ * Both return the time left of cmd_timeout in ms, at least 1 if the
+ * command completed, 0 on timeout.
+ *
+ * Polling is needed on mem, which issues commands under the spinlock,
+ * and until irqs are enabled. It's done in ACX_CMD_POLL_US steps, a
+ * command typically takes far less than a 1ms tick.
+ */
+#define ACX_CMD_POLL_US	10
+
+static unsigned acx_poll_cmd_complete(acx_device_t *adev,
+				unsigned cmd_timeout)
+{
+	ktime_t end = ktime_add_ms(ktime_get(), cmd_timeout);
+	s64 left;
+
+	do {
+		if (read_reg16(adev, IO_ACX_IRQ_STATUS_NON_DES)
+			& HOST_INT_CMD_COMPLETE) {
+			write_reg16(adev, IO_ACX_IRQ_ACK, HOST_INT_CMD_COMPLETE);
+			left = ktime_to_ms(ktime_sub(end, ktime_get()));
+			return (left > 0) ? left : 1;
+		}
+
+		if (IS_MEM(adev))
+			udelay(ACX_CMD_POLL_US);
+		else
+			usleep_range(ACX_CMD_POLL_US, 10 * ACX_CMD_POLL_US);
+
+	} while (ktime_to_us(ktime_sub(end, ktime_get())) > 0);
+
+	return 0;
+}
+
+static unsigned acx_wait_cmd_complete(acx_device_t *adev,
+				unsigned cmd_timeout)
+{
+	unsigned long left;
+
+	if (!IS_PCI(adev) || !adev->irqs_active)
+		return acx_poll_cmd_complete(adev, cmd_timeout);
+
+	left = wait_for_completion_timeout(&adev->cmd_done,
+					msecs_to_jiffies(cmd_timeout));
+	if (left)
+		return jiffies_to_msecs(left) ? : 1;
+
+	/* Irq lost? Have a last look */
+	return acx_poll_cmd_complete(adev, 0);
+}
+
 /*
  * _acx_issue_cmd_timeo_debug
  *
@@ -1500,7 +1710,6 @@ int _acx_issue_cmd_timeo_debug(acx_device_t *adev, unsigned cmd,
 			unsigned cmd_timeout, const char *cmdstr)
 {
 	unsigned long start = jiffies;
-	unsigned long timeout;
 	unsigned counter;
 	const char *devname;
 	u16 irqtype;
@@ -1559,6 +1768,7 @@ int _acx_issue_cmd_timeo_debug(acx_device_t *adev, unsigned cmd,
 	acx_write_cmd_type_status(adev, cmd, 0);
 
 	/* execute command */
+	reinit_completion(&adev->cmd_done);
 	write_reg16(adev, IO_ACX_INT_TRIG, INT_TRIG_CMD);
 	write_flush(adev);
 
@@ -1570,24 +1780,8 @@ int _acx_issue_cmd_timeo_debug(acx_device_t *adev, unsigned cmd,
 	if (unlikely(cmd_timeout > 1199))
 		cmd_timeout = 1199;
 
-	/* we schedule away sometimes (timeout can be large) */
-	counter = cmd_timeout;
-	/* pci only */
-	timeout = jiffies + cmd_timeout * HZ / 1000;
-
-	do {
-		irqtype = read_reg16(adev, IO_ACX_IRQ_STATUS_NON_DES);
-		if (irqtype & HOST_INT_CMD_COMPLETE) {
-			write_reg16(adev, IO_ACX_IRQ_ACK, HOST_INT_CMD_COMPLETE);
-			break;
-		}
-
-		if (IS_MEM(adev))
-			udelay(1000);
-		else
-			msleep(1);
-
-	} while (likely(--counter));
+	counter = acx_wait_cmd_complete(adev, cmd_timeout);
+	irqtype = read_reg16(adev, IO_ACX_IRQ_STATUS_NON_DES);
 
 	/* save state for debugging */
 	cmd_status = acx_read_cmd_type_status(adev);
@@ -1823,8 +2017,13 @@ int acx_reset_dev(acx_device_t *adev)
 	const char* msg = "";
 	int result = NOT_OK;
 	u16 ecpu_ctrl;
+	ktime_t t0;
 	acxmem_lock_flags;
 
+	/* Fw settings are lost */
+	acx_cfg_shadow_reset(adev);
+	adev->resume_fresh = 0;
+
 	acxmem_lock();
 	/* reset the device to make sure the eCPU is stopped
 	 * to upload the firmware correctly */
@@ -1862,7 +2061,9 @@ int acx_reset_dev(acx_device_t *adev)
 	acxmem_unlock();
 
 	/* wait for eCPU bootup */
+	t0 = ktime_get();
 	result = acx_verify_init(adev);
+	adev->boot_ns[ACX_BOOT_ECPU] = ktime_to_ns(ktime_sub(ktime_get(), t0));
 	if (OK != result) {
 		msg = "acx: timeout waiting for eCPU. ";
 		goto end_fail;
@@ -1988,12 +2189,12 @@ static void acxmem_i_set_multicast_list(struct net_device *ndev)
  * ==================================================
  */
 
-static void acx_process_rxdesc(acx_device_t *adev)
+static void acx_process_rxdesc(acx_device_t *adev, unsigned int budget)
 {
 	if(IS_PCI(adev))
-		acxpci_process_rxdesc(adev);
+		acxpci_process_rxdesc(adev, budget);
 	else
-		acxmem_process_rxdesc(adev);
+		acxmem_process_rxdesc(adev, budget);
 
 }
 
@@ -2013,7 +2214,7 @@ static txhostdesc_t *acx_get_txhostdesc(acx_device_t *adev, txacxdesc_t *txdesc,
 		return NULL;
 	}
 	index /= adev->hw_tx_queue[queue_id].acxdescinfo.size;
-	if (unlikely(ACX_DEBUG && (index >= TX_CNT))) {
+	if (unlikely(ACX_DEBUG && (index >= adev->tx_cnt))) {
 		pr_acx("bad txdesc ptr %p\n", txdesc);
 		return NULL;
 	}
@@ -2028,6 +2229,80 @@ void *_acx_get_txbuf(acx_device_t *adev, tx_t *tx_opaque, int q)
 	return acx_get_txhostdesc(adev, (txacxdesc_t *) tx_opaque, q)->data;
 }
 
+/*
+ * _acx_tx_map_skb
+ *
+ * Zero-copy tx for PCI: maps skb->data for the acx and points both
+ * hostdescs of the txdesc into it, instead of into the coherent
+ * txbuf.  The mapping is released in acx_tx_clean_txdesc().
+ *
+ * Returns NOT_OK if the caller must copy the frame into the txbuf as
+ * usual (small or non-linear skbs, mapping failures, other buses).
+ */
+int _acx_tx_map_skb(acx_device_t *adev, tx_t *tx_opaque,
+		struct sk_buff *skb, int queue_id)
+{
+	txhostdesc_t *hostdesc1, *hostdesc2;
+	dma_addr_t phy;
+
+	if (!adev->tx_zerocopy || !acx_tx_zerocopy)
+		return NOT_OK;
+
+	if (skb->len <= ACX_TX_COPYBREAK || skb_is_nonlinear(skb)
+		|| skb->len > WLAN_A4FR_MAXLEN_WEP_FCS)
+		return NOT_OK;
+
+	hostdesc1 = acx_get_txhostdesc(adev, (txacxdesc_t *) tx_opaque,
+				queue_id);
+	if (unlikely(!hostdesc1))
+		return NOT_OK;
+	hostdesc2 = hostdesc1 + 1;
+
+	phy = dma_map_single(adev->bus_dev, skb->data, skb->len,
+			DMA_TO_DEVICE);
+	if (unlikely(dma_mapping_error(adev->bus_dev, phy))) {
+		log(L_BUFT, "tx: dma_map_single failed, copying frame\n");
+		return NOT_OK;
+	}
+
+	hostdesc1->skb_phy = phy;
+	hostdesc1->skb_maplen = skb->len;
+
+	/* Same split as with the txbuf: header in hostdesc1, body in
+	 * hostdesc2, both adjacent in memory */
+	hostdesc1->hd.data_phy = cpu2acx(phy);
+	hostdesc2->hd.data_phy = cpu2acx(phy + BUF_LEN_HOSTDESC1);
+
+	return OK;
+}
+
+/* Undo _acx_tx_map_skb() and point the hostdescs back at their txbuf */
+static void acx_tx_unmap_skb(acx_device_t *adev, txhostdesc_t *hostdesc1,
+			int queue_id)
+{
+	struct hw_tx_queue *tx = &adev->hw_tx_queue[queue_id];
+	dma_addr_t buf_phy;
+	int index;
+
+	if (!hostdesc1->skb_maplen)
+		return;
+
+	dma_unmap_single(adev->bus_dev, hostdesc1->skb_phy,
+			hostdesc1->skb_maplen, DMA_TO_DEVICE);
+	hostdesc1->skb_maplen = 0;
+
+	index = (hostdesc1 - tx->hostdescinfo.start) / 2;
+	buf_phy = tx->bufinfo.phy + index * WLAN_A4FR_MAXLEN_WEP_FCS;
+	hostdesc1->hd.data_phy = cpu2acx(buf_phy);
+	(hostdesc1 + 1)->hd.data_phy = cpu2acx(buf_phy + BUF_LEN_HOSTDESC1);
+}
+
+static void acx_tx_batch_account(acx_device_t *adev, unsigned int n)
+{
+	adev->tx_doorbells++;
+	adev->tx_batch_hist[min_t(unsigned int, n, ACX_TX_BATCH_HIST_LEN) - 1]++;
+}
+
 /*
  * acxmem_l_tx_data
  *
@@ -2053,6 +2328,7 @@ void _acx_tx_data(acx_device_t *adev, tx_t *tx_opaque, int len,
 	u8 Ctl_8, Ctl2_8;
 	int wlhdr_len;
 	u32 addr;		// mem.c
+	struct acxmem_desc_wc wc;	// mem.c
 	acxmem_lock_flags;	// mem.c
 
 
@@ -2071,9 +2347,24 @@ void _acx_tx_data(acx_device_t *adev, tx_t *tx_opaque, int len,
 	/* modify flag status in separate variable to be able to write
 	 * it back in one big swoop later (also in order to have less
 	 * device memory accesses) */
-	Ctl_8 = (IS_MEM(adev))
-		? read_slavemem8(adev, (uintptr_t) &(txdesc->Ctl_8))
-		: txdesc->Ctl_8;
+	if (IS_MEM(adev)) {
+		/* The desc fields are staged in wc and written back
+		 * word by word at the end. acx100 descs are ours
+		 * from init on, and init and the clean paths leave
+		 * them zero but for the next pointer, Ctl_8 and the
+		 * rate, so the length and rate words needn't be
+		 * read. acx111 descs come preinitialized by the fw */
+		acxmem_desc_wc_init(&wc, (uintptr_t) txdesc);
+		if (!IS_ACX111(adev)) {
+			acxmem_desc_wc_assume_zero(&wc,
+				offsetof(txacxdesc_t, total_length), 4);
+			acxmem_desc_wc_assume_zero(&wc,
+				offsetof(txacxdesc_t, rts_failures), 4);
+		}
+		Ctl_8 = acxmem_desc_wc_read8(adev, &wc,
+					offsetof(txacxdesc_t, Ctl_8));
+	} else
+		Ctl_8 = txdesc->Ctl_8;
 
 	Ctl2_8 = 0; /* really need to init it to 0, not txdesc->Ctl2_8, it seems */
 
@@ -2082,7 +2373,8 @@ void _acx_tx_data(acx_device_t *adev, tx_t *tx_opaque, int len,
 	if (IS_PCI(adev))
 		txdesc->total_length = cpu_to_le16(len);
 	else
-		write_slavemem16(adev, (uintptr_t)&(txdesc->total_length),
+		acxmem_desc_wc_write16(adev, &wc,
+				offsetof(txacxdesc_t, total_length),
 				cpu_to_le16(len));
 
 	hostdesc2->hd.length = (len - wlhdr_len) > 0 ? cpu_to_le16(len - wlhdr_len) : 0;
@@ -2110,7 +2402,12 @@ void _acx_tx_data(acx_device_t *adev, tx_t *tx_opaque, int len,
 
 		/* note that if !txdesc->do_auto, txrate->cur has only
 		 * one nonzero bit */
-		txdesc->u.r2.rate111 = cpu_to_le16(rateset);
+		if (IS_MEM(adev))
+			acxmem_desc_wc_write16(adev, &wc,
+				offsetof(txacxdesc_t, u.r2.rate111),
+				cpu_to_le16(rateset));
+		else
+			txdesc->u.r2.rate111 = cpu_to_le16(rateset);
 
 		/* WARNING: I was never able to make it work with
 		 * prism54 AP.  It was falling down to 1Mbit where
@@ -2137,7 +2434,8 @@ void _acx_tx_data(acx_device_t *adev, tx_t *tx_opaque, int len,
 		if (IS_PCI(adev))
 			txdesc->u.r1.rate = (u8) rateset;
 		else
-			write_slavemem8(adev, (uintptr_t)&(txdesc->u.r1.rate),
+			acxmem_desc_wc_write8(adev, &wc,
+					offsetof(txacxdesc_t, u.r1.rate),
 					(u8) rateset);
 
 #ifdef TODO_FIGURE_OUT_WHEN_TO_SET_THIS
@@ -2199,9 +2497,13 @@ void _acx_tx_data(acx_device_t *adev, tx_t *tx_opaque, int len,
 				pr_info("Bummer. Not enough room in the txbuf_space.\n");
 				hostdesc1->hd.length = 0;
 				hostdesc2->hd.length = 0;
-				write_slavemem16(adev, (uintptr_t) &(txdesc->total_length), 0);
-				write_slavemem8(adev, (uintptr_t) &(txdesc->Ctl_8), DESC_CTL_HOSTOWN
-						| DESC_CTL_FIRSTFRAG);
+				acxmem_desc_wc_write16(adev, &wc,
+					offsetof(txacxdesc_t, total_length), 0);
+				acxmem_desc_wc_write8(adev, &wc,
+					offsetof(txacxdesc_t, Ctl_8),
+					DESC_CTL_HOSTOWN | DESC_CTL_FIRSTFRAG);
+				acxmem_desc_wc_commit(adev, &wc,
+					offsetof(txacxdesc_t, Ctl_8));
 				adev->hw_tx_queue[queue_id].head = ((u8*) txdesc - (u8*) adev->hw_tx_queue[queue_id].acxdescinfo.start)
 						/ adev->hw_tx_queue[queue_id].acxdescinfo.size;
 				adev->hw_tx_queue[queue_id].free++;
@@ -2210,7 +2512,8 @@ void _acx_tx_data(acx_device_t *adev, tx_t *tx_opaque, int len,
 			/*
 			 * Tell the ACX where the packet is.
 			 */
-			write_slavemem32(adev, (uintptr_t) &(txdesc->AcxMemPtr), addr);
+			acxmem_desc_wc_write32(&wc,
+				offsetof(txacxdesc_t, AcxMemPtr), addr);
 		}
 	}
 
@@ -2232,8 +2535,12 @@ void _acx_tx_data(acx_device_t *adev, tx_t *tx_opaque, int len,
 	/* At this point Ctl_8 should just be FIRSTFRAG */
 
 	if (IS_MEM(adev)) {
-		write_slavemem8(adev, (uintptr_t) &(txdesc->Ctl2_8), Ctl2_8);
-		write_slavemem8(adev, (uintptr_t) &(txdesc->Ctl_8), Ctl_8);
+		acxmem_desc_wc_write8(adev, &wc,
+				offsetof(txacxdesc_t, Ctl2_8), Ctl2_8);
+		acxmem_desc_wc_write8(adev, &wc,
+				offsetof(txacxdesc_t, Ctl_8), Ctl_8);
+		acxmem_desc_wc_commit(adev, &wc,
+				offsetof(txacxdesc_t, Ctl_8));
 	} else {
              txdesc->Ctl2_8 = Ctl2_8;
 	     txdesc->Ctl_8 = Ctl_8;
@@ -2246,10 +2553,17 @@ void _acx_tx_data(acx_device_t *adev, tx_t *tx_opaque, int len,
 	if (IS_MEM(adev))
 		acxmem_update_queue_indicator(adev, 0);
 
-	/* flush writes before we tell the adapter that it's its turn now */
-	mmiowb();
-	write_reg16(adev, IO_ACX_INT_TRIG, INT_TRIG_TXPRC);
-	write_flush(adev);
+	/* When called from acx_tx_queue_go() the doorbell is rung
+	 * once for the whole batch in acx_tx_kick() */
+	if (adev->tx_batching)
+		adev->tx_batch_pending++;
+	else {
+		/* flush writes before we tell the adapter that it's its turn now */
+		mmiowb();
+		write_reg16(adev, IO_ACX_INT_TRIG, INT_TRIG_TXPRC);
+		write_flush(adev);
+		acx_tx_batch_account(adev, 1);
+	}
 
 	hostdesc1->skb = skb;
 
@@ -2263,7 +2577,7 @@ end_of_chain:
 	/* Debugging */
 	if (unlikely(acx_debug & (L_XFER|L_DATA))) {
 		u16 fc = ((struct ieee80211_hdr *)
-			hostdesc1->data)->frame_control;
+			skb->data)->frame_control;
 		if (IS_ACX111(adev))
 			pr_acx("tx: pkt (%s): len %d "
 				"rate %04X%s status %u\n",
@@ -2284,7 +2598,7 @@ end_of_chain:
 
 		if (0 && acx_debug & L_DATA) {
 			pr_acx("tx: 802.11 [%d]: ", len);
-			acx_dump_bytes(hostdesc1->data, len);
+			acx_dump_bytes(skb->data, len);
 		}
 	}
 
@@ -2294,6 +2608,51 @@ end_of_chain:
 }
 #endif	// acxmem_tx_data()
 
+/*
+ * acx_tx_kick
+ *
+ * Tells the acx about all txdescs queued by _acx_tx_data() since the
+ * last call, using a single TXPRC doorbell. Ownership of each txdesc
+ * was already passed in _acx_tx_data(), so all that's left is to make
+ * sure those writes reached the device before we trigger it.
+ */
+void acx_tx_kick(acx_device_t *adev)
+{
+	unsigned int pending = adev->tx_batch_pending;
+	acxmem_lock_flags;
+
+	if (!pending)
+		return;
+
+	acxmem_lock();
+
+	/* flush writes before we tell the adapter that it's its turn now */
+	wmb();
+	mmiowb();
+	write_reg16(adev, IO_ACX_INT_TRIG, INT_TRIG_TXPRC);
+	write_flush(adev);
+
+	adev->tx_batch_pending = 0;
+	acx_tx_batch_account(adev, pending);
+
+	acxmem_unlock();
+
+	log(L_BUFT, "tx: kicked %u frames\n", pending);
+}
+
+/*
+ * On MEM the part of a txdesc the clean path looks at, AcxMemPtr up
+ * to the rate, is fetched with one burst read, instead of a slave
+ * read per field. Every single slave access costs three register
+ * accesses (ctl, addr, data), a burst two plus one per word; the
+ * clean path counts them for the tx_flow debugfs file.
+ */
+#define TXDESC_SNAP_START	offsetof(txacxdesc_t, AcxMemPtr)
+#define TXDESC_SNAP_LEN		(offsetof(txacxdesc_t, queue_info) \
+				 - TXDESC_SNAP_START)
+#define ACXMEM_SINGLE_MMIO	3
+#define ACXMEM_BURST_MMIO(len)	(2 + DIV_ROUND_UP(len, 4))
+
 /*
  * acxmem_l_clean_txdesc
  *
@@ -2314,7 +2673,7 @@ unsigned int acx_tx_clean_txdesc(acx_device_t *adev, int queue_id)
 	u16 r111;
 	u8 error, ack_failures, rts_failures, rts_ok, r100, Ctl_8;
 	u32 acxmem;
-	txacxdesc_t tmptxdesc;
+	txacxdesc_t tmptxdesc, snap;
 
 	struct ieee80211_tx_info *txstatus;
 
@@ -2354,9 +2713,15 @@ unsigned int acx_tx_clean_txdesc(acx_device_t *adev, int queue_id)
 		 * here. */
 
 		/* stop if not marked as "tx finished" and "host owned" */
-		Ctl_8 = (IS_MEM(adev))
-			? read_slavemem8(adev, (uintptr_t) &(txdesc->Ctl_8))
-			: txdesc->Ctl_8;
+		if (IS_MEM(adev)) {
+			acxmem_copy_from_slavemem(adev,
+				(u8 *) &snap + TXDESC_SNAP_START,
+				(uintptr_t) txdesc + TXDESC_SNAP_START,
+				TXDESC_SNAP_LEN);
+			adev->txclean_mmio += ACXMEM_BURST_MMIO(TXDESC_SNAP_LEN);
+			Ctl_8 = snap.Ctl_8;
+		} else
+			Ctl_8 = txdesc->Ctl_8;
 
 		/* OW FIXME Check against pci.c */
 		if ((Ctl_8 & DESC_CTL_ACXDONE_HOSTOWN)
@@ -2373,17 +2738,12 @@ unsigned int acx_tx_clean_txdesc(acx_device_t *adev, int queue_id)
 
 		/* remember desc values... */
 		if (IS_MEM(adev)) {
-			error = read_slavemem8(adev, (uintptr_t) &(txdesc->error));
-			ack_failures = read_slavemem8(adev,
-					(uintptr_t) &(txdesc->ack_failures));
-			rts_failures = read_slavemem8(adev,
-					(uintptr_t) &(txdesc->rts_failures));
-			rts_ok = read_slavemem8(adev, (uintptr_t) &(txdesc->rts_ok));
-			/* OW FIXME does this also require le16_to_cpu()? */
-			r100 = read_slavemem8(adev,
-					(uintptr_t) &(txdesc->u.r1.rate));
-			r111 = le16_to_cpu(read_slavemem16(adev,
-					(uintptr_t)&(txdesc->u.r2.rate111)));
+			error = snap.error;
+			ack_failures = snap.ack_failures;
+			rts_failures = snap.rts_failures;
+			rts_ok = snap.rts_ok;
+			r100 = snap.u.r1.rate;
+			r111 = le16_to_cpu(snap.u.r2.rate111);
 		} else {
 			error = txdesc->error;
 			ack_failures = txdesc->ack_failures;
@@ -2420,10 +2780,11 @@ unsigned int acx_tx_clean_txdesc(acx_device_t *adev, int queue_id)
 
 		/* Free up the transmit data buffers */
 		if (IS_MEM(adev)) {
-			acxmem = read_slavemem32(adev,
-						(uintptr_t) &(txdesc->AcxMemPtr));
-			if (acxmem)
+			acxmem = acx2cpu(snap.AcxMemPtr);
+			if (acxmem) {
 				acxmem_reclaim_acx_txbuf_space(adev, acxmem);
+				adev->txclean_mmio += ACXMEM_SINGLE_MMIO;
+			}
 
 			/* ...and free the desc by clearing all the fields
 			   except the next pointer */
@@ -2432,7 +2793,12 @@ unsigned int acx_tx_clean_txdesc(acx_device_t *adev, int queue_id)
 				(u8 *) &(tmptxdesc.HostMemPtr),
 				( sizeof(tmptxdesc)
 				  - sizeof(tmptxdesc.pNextDesc)));
+			adev->txclean_mmio += ACXMEM_BURST_MMIO(
+				sizeof(tmptxdesc) - sizeof(tmptxdesc.pNextDesc));
+			adev->txclean_descs++;
 		} else {
+			acx_tx_unmap_skb(adev, hostdesc, queue_id);
+
 			txdesc->error = 0;
 			txdesc->ack_failures = 0;
 			txdesc->rts_failures = 0;
@@ -2467,7 +2833,7 @@ unsigned int acx_tx_clean_txdesc(acx_device_t *adev, int queue_id)
 #endif
 		}
 		/* update pointer for descr to be cleaned next */
-		finger = (finger + 1) % TX_CNT;
+		finger = (finger + 1) & adev->tx_mask;
 	}
 	/* remember last position */
 	adev->hw_tx_queue[queue_id].tail = finger;
@@ -2481,15 +2847,18 @@ unsigned int acx_tx_clean_txdesc(acx_device_t *adev, int queue_id)
 void acx_clean_txdesc_emergency(acx_device_t *adev)
 {
 	txacxdesc_t *txd;
+	struct acxmem_desc_wc wc;
 	int i;
 
 
 
-	for (i = 0; i < TX_CNT; i++) {
+	for (i = 0; i < adev->tx_cnt; i++) {
 		txd = acx_get_txacxdesc(adev, i, 0);
 
 		/* free it */
 		if (IS_PCI(adev)) {
+			acx_tx_unmap_skb(adev,
+				acx_get_txhostdesc(adev, txd, 0), 0);
 			txd->ack_failures = 0;
 			txd->rts_failures = 0;
 			txd->rts_ok = 0;
@@ -2497,12 +2866,21 @@ void acx_clean_txdesc_emergency(acx_device_t *adev)
 			txd->Ctl_8 = DESC_CTL_HOSTOWN;
 			continue;
 		} else {
-			write_slavemem8(adev, (uintptr_t) &(txd->ack_failures), 0);
-			write_slavemem8(adev, (uintptr_t) &(txd->rts_failures), 0);
-			write_slavemem8(adev, (uintptr_t) &(txd->rts_ok), 0);
-			write_slavemem8(adev, (uintptr_t) &(txd->error), 0);
-			write_slavemem8(adev, (uintptr_t) &(txd->Ctl_8),
-					DESC_CTL_HOSTOWN);
+			/* the rest of the two status words is zeroed
+			 * as well, see _acx_tx_data() */
+			acxmem_desc_wc_init(&wc, (uintptr_t) txd);
+			acxmem_desc_wc_assume_zero(&wc,
+				offsetof(txacxdesc_t, Ctl_8), 8);
+			acxmem_desc_wc_write8(adev, &wc,
+				offsetof(txacxdesc_t, ack_failures), 0);
+			acxmem_desc_wc_write8(adev, &wc,
+				offsetof(txacxdesc_t, rts_failures), 0);
+			acxmem_desc_wc_write8(adev, &wc,
+				offsetof(txacxdesc_t, rts_ok), 0);
+			acxmem_desc_wc_write8(adev, &wc,
+				offsetof(txacxdesc_t, error), 0);
+			acxmem_desc_wc_write8(adev, &wc,
+				offsetof(txacxdesc_t, Ctl_8), DESC_CTL_HOSTOWN);
 		}
 #if 0
 		u32 acxmem;
@@ -2514,9 +2892,10 @@ void acx_clean_txdesc_emergency(acx_device_t *adev)
 		if (acxmem)
 			acxmem_reclaim_acx_txbuf_space(adev, acxmem);
 #endif
-		write_slavemem32(adev, (uintptr_t) &(txd->AcxMemPtr), 0);
+		acxmem_desc_wc_write32(&wc, offsetof(txacxdesc_t, AcxMemPtr), 0);
+		acxmem_desc_wc_commit(adev, &wc, offsetof(txacxdesc_t, Ctl_8));
 	}
-	adev->hw_tx_queue[0].free = TX_CNT;
+	adev->hw_tx_queue[0].free = adev->tx_cnt;
 
 	if (IS_MEM(adev))
 		acxmem_init_acx_txbuf2(adev);
@@ -2648,24 +3027,53 @@ void acx_handle_info_irq(acx_device_t *adev); // reorder later
 
 #if defined CONFIG_ACX_MAC80211_PCI || defined CONFIG_ACX_MAC80211_MEM
 
-static int acx_is_hw_tx_queue_start_limit(acx_device_t *adev)
+/*
+ * Rx irq coalescing
+ *
+ * The acx raises an irq per rx frame. The ACX1FF_IE_RX_INTR_CONFIG
+ * thresholds are only known on TNETW1450 fw, so the coalescing is
+ * done here instead: after an irq pass that got rx frames, the rx irq
+ * stays masked for rx_coal_usecs, and rx_coal_timer has acx_irq_work()
+ * pick up what arrived meanwhile.
+ *
+ * In adaptive mode, the delay follows the rx rate sampled every
+ * ACX_RX_COAL_SAMPLE, aiming at half a ring per irq. Low rates get
+ * no delay at all, so latency doesn't suffer when idle.
+ */
+static void acx_rx_coal_update(acx_device_t *adev)
 {
-	int i;
+	unsigned long elapsed = jiffies - adev->rx_coal_stamp;
+	unsigned int usecs;
 
-	for (i=0; i<adev->num_hw_tx_queues; i++)
-	{
-		if (!(adev->hw_tx_queue[i].free >= TX_START_QUEUE))
-		{
-			log(L_BUF, "Queue under start limie: queue_id=%d, free=%d\n",
-				i, adev->hw_tx_queue[i].free);
-			return 0;
-		}
-	}
+	if (elapsed < ACX_RX_COAL_SAMPLE)
+		return;
 
-	return 1;
+	adev->rx_rate = (adev->rx_coal_frames - adev->rx_coal_frames_last)
+		* HZ / elapsed;
+	adev->irq_rate = (adev->irq_count - adev->irq_count_last)
+		* HZ / elapsed;
+	adev->rx_coal_frames_last = adev->rx_coal_frames;
+	adev->irq_count_last = adev->irq_count;
+	adev->rx_coal_stamp = jiffies;
+
+	if (adev->rx_coal_mode != ACX_RX_COAL_ADAPTIVE)
+		usecs = clamp(adev->rx_coal_mode, 0, ACX_RX_COAL_MAX_USECS);
+	else if (adev->rx_rate < ACX_RX_COAL_LOW_RATE)
+		usecs = 0;
+	else
+		usecs = min_t(unsigned int, ACX_RX_COAL_ADAPT_USECS,
+			(adev->rx_cnt / 2) * USEC_PER_SEC / adev->rx_rate);
+
+	adev->rx_coal_usecs = usecs;
 }
 
-#define IRQ_ITERATE 0 // mem.c has it 1, but thats in #if0d code.
+/* Max rx descs per irq pass, 0: no limit */
+unsigned int acx_rx_budget_limit(acx_device_t *adev)
+{
+	if (acx_rx_budget < 0)
+		return adev->rx_cnt / 2;
+	return acx_rx_budget;
+}
 
 /* Interrupt handler bottom-half */
 void acx_irq_work(struct work_struct *work)
@@ -2674,20 +3082,37 @@ void acx_irq_work(struct work_struct *work)
 	int irqreason;
 	int irqmasked;
 	acxmem_lock_flags;
-	unsigned int irqcnt = 0; // but always do-while once, see IRQ_ITERATE
+	unsigned int pass = 0, passes;
+	unsigned long rx_frames;
+	int rx_pending;
 	int i;
-
-
+	ktime_t t0;
+	u64 ns;
 
 	acx_sem_lock(adev);
+	t0 = ktime_get();
 	acxmem_lock();
 
+	/* Budgeted rx polling: rx frames are collected on
+	 * rx_poll_list and handed up after the lock is dropped. If
+	 * the budget runs out, irqs stay masked and we poll again. */
+	adev->rx_polling = (acx_rx_budget_limit(adev) > 0);
+	rx_pending = adev->rx_poll_pending || adev->rx_coal_pending;
+	adev->rx_poll_pending = 0;
+	adev->rx_coal_pending = 0;
+	rx_frames = adev->rx_coal_frames;
+
 	/* OW, 20100611: Iterating and latency:
 	 * IRQ iteration can improve latency, by avoiding waiting for
 	 * the scheduling of the tx worklet.
+	 *
+	 * With irqiterate > 0, IO_ACX_IRQ_REASON is read again after
+	 * each pass, and new events are handled right away, up to
+	 * irqiterate extra passes.
 	 */
+	passes = 1 + min_t(unsigned int, acx_irq_iterate, ACX_IRQ_ITERATE_MAX);
 
-	do {  // IRQ_ITERATE, but at least once
+	do {
 
 	/* We only get an irq-signal for IO_ACX_IRQ_MASK unmasked irq
 	 * reasons.  However masked irq reasons we still read with
@@ -2697,9 +3122,9 @@ void acx_irq_work(struct work_struct *work)
 	irqmasked = irqreason & ~adev->irq_mask;
 	log(L_IRQ, "irqstatus=%04X, irqmasked==%04X\n", irqreason, irqmasked);
 
-#if IRQ_ITERATE
-	if (!irqmasked) break;
-#endif	/* IRQ_ITERATE */
+	/* Nothing new since the last pass */
+	if (pass && !irqmasked && !rx_pending)
+		break;
 
 		/* HOST_INT_CMD_COMPLETE handling */
 		if (irqmasked & HOST_INT_CMD_COMPLETE) {
@@ -2739,35 +3164,34 @@ void acx_irq_work(struct work_struct *work)
 			 * resolved this problem.  Now WPA assoc
 			 * succeeds directly and robust.
 			 */
-			for (i=0; i<adev->num_hw_tx_queues; i++)
+			/* Restart the ACs stopped on a queue, once
+			 * it has enough tx-descr free again */
+			for (i=0; i<adev->num_hw_tx_queues; i++) {
 				acx_tx_clean_txdesc(adev, i);
-
-			/* Restart queue if stopped and enough tx-descr free */
-			if (acx_is_hw_tx_queue_start_limit(adev) &&
-				acx_queue_stopped(adev->hw))
-			{
-				log(L_BUF,"tx: wake queue\n");
-				acx_wake_queue(adev->hw, NULL);
-				/* Schedule the tx, since it doesn't harm. Required in case of irq-iteration. */
-				ieee80211_queue_work(adev->hw, &adev->tx_work);
+				acx_tx_wake_hw_queue(adev, i);
 			}
 
 		}
 
 		/* Rx processing TODO - examine merged flags !!! */
-		if (irqmasked
+		if (rx_pending || (irqmasked
 			& (IS_MEM(adev)
-			   ? HOST_INT_RX_DATA : HOST_INT_RX_COMPLETE)) {
+			   ? HOST_INT_RX_DATA : HOST_INT_RX_COMPLETE))) {
 			log(L_IRQ, "got Rx_Complete IRQ\n");
-			acx_process_rxdesc(adev);
+			rx_pending = 0;
+			if (adev->rx_polling)
+				adev->rx_polls++;
+			acx_process_rxdesc(adev, adev->rx_polling ?
+					acx_rx_budget_limit(adev) : 0);
 		}
-#if IRQ_ITERATE
-		/* Tx new frames, after rx processing.  If queue is
-		 * running. We indirectly use this as indicator, that
-		 * tx_free >= TX_START_QUEUE */
-		if (!acx_queue_stopped(adev->hw))
+		/* Tx new frames inline, after rx processing, instead
+		 * of waiting for tx_work. The tx path takes the
+		 * acxmem lock itself. */
+		if (passes > 1 && test_bit(ACX_FLAG_HW_UP, &adev->flags)) {
+			acxmem_unlock();
 			acx_tx_queue_go(adev);
-#endif	/* IRQ_ITERATE */
+			acxmem_lock();
+		}
 
 		/* HOST_INT_INFO */
 		if (irqmasked & HOST_INT_INFO)
@@ -2787,7 +3211,7 @@ void acx_irq_work(struct work_struct *work)
 		if (acx_debug & L_IRQ)
 			acx_log_irq(irqreason);
 
-	} while (irqcnt--);
+	} while (++pass < passes);
 
 	/* Routine to perform blink with range FIXME:
 	 * update_link_quality_led is a stub - add proper code and
@@ -2795,17 +3219,47 @@ void acx_irq_work(struct work_struct *work)
 	 * update_link_quality_led(adev);
 	 */
 
-	/* Renable irq-signal again for irqs we are interested in */
-	write_reg16(adev, IO_ACX_IRQ_MASK, adev->irq_mask);
-	write_flush(adev);
+	acx_rx_coal_update(adev);
+
+	if (adev->rx_poll_pending && adev->irqs_active) {
+		/* Rx ring not drained: keep irqs masked, poll again */
+		adev->rx_budget_exhausted++;
+		acx_schedule_task(adev, 0);
+	} else if (adev->rx_coal_usecs && adev->irqs_active
+		&& adev->rx_coal_frames != rx_frames) {
+		/* Rearm all but rx, rx after the coalescing delay */
+		write_reg16(adev, IO_ACX_IRQ_MASK, adev->irq_mask
+			| (IS_MEM(adev) ? HOST_INT_RX_DATA : HOST_INT_RX_COMPLETE));
+		write_flush(adev);
+		adev->rx_coal_pending = 1;
+		adev->rx_coal_delays++;
+		hrtimer_start(&adev->rx_coal_timer,
+			ktime_set(0, adev->rx_coal_usecs * NSEC_PER_USEC),
+			HRTIMER_MODE_REL);
+	} else {
+		/* Renable irq-signal again for irqs we are interested in */
+		write_reg16(adev, IO_ACX_IRQ_MASK, adev->irq_mask);
+		write_flush(adev);
+		adev->irq_rearms++;
+	}
 
 	acxmem_unlock();
 
+	adev->rx_polling = 0;
+	acx_rx_deliver_list(adev);
+
 	/* after_interrupt_jobs: need to be done outside acx_lock
 	   (Sleeping required. None atomic) */
 	if (adev->after_interrupt_jobs)
 		acx_after_interrupt_task(adev);
 
+	ns = ktime_to_ns(ktime_sub(ktime_get(), t0));
+	adev->irq_works++;
+	adev->irq_passes[min(pass, passes) - 1]++;
+	adev->irq_work_ns += ns;
+	if (ns > adev->irq_work_max_ns)
+		adev->irq_work_max_ns = ns;
+
 	acx_sem_unlock(adev);
 
 
@@ -2977,7 +3431,7 @@ static irqreturn_t acxmem_interrupt(int irq, void *dev_id)
 		 */
 		if (irqtype & HOST_INT_RX_DATA) {
 			log(L_IRQ, "got Rx_Data IRQ\n");
-			acx_process_rxdesc(adev);
+			acx_process_rxdesc(adev, 0);
 		}
 
 		if (irqtype & HOST_INT_TX_COMPLETE) {
@@ -3114,15 +3568,20 @@ int acx_op_start(struct ieee80211_hw *hw)
 
 	clear_bit(ACX_FLAG_HW_UP, &adev->flags);
 
-	/* With vlynq a full reset doesn't work yet */
-	if (!IS_VLYNQ(adev))
+	/* With vlynq a full reset doesn't work yet. After a resume
+	 * the fw is fresh and has our settings already */
+	if (!IS_VLYNQ(adev) && !adev->resume_fresh)
 		acx_full_reset(adev);
 
 	acxmem_lock();
 	acx_irq_enable(adev);
 	acxmem_unlock();
 
-	acx_update_settings(adev);
+	if (adev->resume_fresh) {
+		adev->resume_fresh = 0;
+		acx_apply_settings(adev);
+	} else
+		acx_update_settings(adev);
 
 	set_bit(ACX_FLAG_HW_UP, &adev->flags);
 
@@ -3157,6 +3616,7 @@ void acx_stop(acx_device_t *adev)
 	synchronize_irq(adev->irq);
 
 	acx_sem_unlock(adev);
+	hrtimer_cancel(&adev->rx_coal_timer);
 	cancel_work_sync(&adev->irq_work);
 	cancel_work_sync(&adev->tx_work);
 	acx_sem_lock(adev);
@@ -3411,7 +3871,7 @@ int acx111pci_ioctl_info(struct ieee80211_hw *hw, struct iw_request_info *info,
 
 	/* loop over complete receive pool */
 	if (rxdesc)
-		for (i = 0; i < RX_CNT; i++) {
+		for (i = 0; i < adev->rx_cnt; i++) {
 			pr_acx("\ndump internal rxdesc %d:\n"
 				"mem pos %p\n"
 				"next 0x%X\n"
@@ -3435,7 +3895,7 @@ int acx111pci_ioctl_info(struct ieee80211_hw *hw, struct iw_request_info *info,
 
 		/* loop over complete receive pool */
 		if (rxhostdesc)
-		for (i = 0; i < RX_CNT; i++) {
+		for (i = 0; i < adev->rx_cnt; i++) {
 			pr_acx("\ndump host rxdesc %d:\n"
 				"mem pos %p\n"
 				"buffer mem pos 0x%X\n"
@@ -3460,7 +3920,7 @@ int acx111pci_ioctl_info(struct ieee80211_hw *hw, struct iw_request_info *info,
 
 		/* loop over complete transmit pool */
 		if (txdesc)
-		for (i = 0; i < TX_CNT; i++) {
+		for (i = 0; i < adev->tx_cnt; i++) {
 			pr_acx("\ndump internal txdesc %d:\n"
 				"size 0x%X\n"
 				"mem pos %p\n"
@@ -3492,7 +3952,7 @@ int acx111pci_ioctl_info(struct ieee80211_hw *hw, struct iw_request_info *info,
 
 		/* loop over complete host send pool */
 		if (txhostdesc)
-		for (i = 0; i < TX_CNT * 2; i++) {
+		for (i = 0; i < adev->tx_cnt * 2; i++) {
 			pr_acx("\ndump host txdesc %d:\n"
 				"mem pos %p\n"
 				"buffer mem pos 0x%X\n"
@@ -83,10 +83,18 @@ DECL_OR_STUB ( PCI_OR_MEM,
 			struct ieee80211_tx_info *info, struct sk_buff *skb, int queue_id),
 	{ } )
 
+DECL_OR_STUB ( PCI_OR_MEM,
+	void acx_tx_kick(acx_device_t *adev),
+	{ } )
+
 DECL_OR_STUB ( PCI_OR_MEM,
 	void acx_irq_work(struct work_struct *work),
 	{ } )
 
+DECL_OR_STUB ( PCI_OR_MEM,
+	unsigned int acx_rx_budget_limit(acx_device_t *adev),
+	{ return 0; } )
+
 DECL_OR_STUB ( PCI_OR_MEM,
 	int acx_write_fw(acx_device_t *adev, const firmware_image_t *fw_image,
 			u32 offset),
@@ -142,6 +150,11 @@ DECL_OR_STUB ( PCI_OR_MEM,
 	void *_acx_get_txbuf(acx_device_t * adev, tx_t * tx_opaque, int queue_id),
 	{ return (void*) NULL; } )
 
+DECL_OR_STUB ( PCI_OR_MEM,
+	int _acx_tx_map_skb(acx_device_t *adev, tx_t *tx_opaque,
+			struct sk_buff *skb, int queue_id),
+	{ return NOT_OK; } )
+
 
 #if (defined CONFIG_ACX_MAC80211_PCI || defined CONFIG_ACX_MAC80211_MEM)
 
@@ -160,7 +173,8 @@ static inline txacxdesc_t* acx_advance_txacxdesc(acx_device_t *adev,
 
 void acx_base_reset_mac(acx_device_t *adev, int middelay);
 int acx_get_hardware_info(acx_device_t *adev);
-int acx_load_firmware(acx_device_t *adev, char *fw_image_filename, char *radio_image_filename);
+int acx_load_firmware(acx_device_t *adev, char *fw_image_filename,
+		char *radio_image_filename, int cached_only);
 int acx_free_firmware(acx_device_t *adev);
 int acx_upload_radio(acx_device_t *adev);
 void acx_stop(acx_device_t *adev);
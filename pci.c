@@ -41,6 +41,7 @@
 #include <linux/workqueue.h>
 #include <linux/nl80211.h>
 #include <linux/interrupt.h>
+#include <linux/ktime.h>
 #include <net/iw_handler.h>
 #include <net/mac80211.h>
 
@@ -405,7 +406,7 @@ int acxpci_dbgfs_diag_output(struct seq_file *file, acx_device_t *adev)
 	seq_printf(file, "** Rx buf **\n");
 	rxhostdesc = adev->hw_rx_queue.hostdescinfo.start;
 	if (rxhostdesc)
-		for (i = 0; i < RX_CNT; i++) {
+		for (i = 0; i < adev->rx_cnt; i++) {
 			rtl = (i == adev->hw_rx_queue.tail) ? " [tail]" : "";
 			if ((rxhostdesc->hd.Ctl_16 & cpu_to_le16(DESC_CTL_HOSTOWN))
 			    && (rxhostdesc->hd.Status & cpu_to_le32(DESC_STATUS_FULL)))
@@ -423,7 +424,7 @@ int acxpci_dbgfs_diag_output(struct seq_file *file, acx_device_t *adev)
 
 		txdesc = adev->hw_tx_queue[queue_id].acxdescinfo.start;
 		if (txdesc)
-			for (i = 0; i < TX_CNT; i++) {
+			for (i = 0; i < adev->tx_cnt; i++) {
 				thd = (i == adev->hw_tx_queue[queue_id].head) ? " [head]" : "";
 				ttl = (i == adev->hw_tx_queue[queue_id].tail) ? " [tail]" : "";
 
@@ -461,6 +462,11 @@ int acxpci_dbgfs_diag_output(struct seq_file *file, acx_device_t *adev)
 		           (unsigned long long)adev->hw_rx_queue.bufinfo.phy);
 	}
 
+	seq_printf(file,
+		"rx zero-copy: %lu frames, %lu copied, %lu refill failures, "
+		"%u spare skbs\n",
+		adev->rx_zerocopy_frames, adev->rx_copybreak_frames,
+		adev->rx_refill_failures, skb_queue_len(&adev->rx_skb_pool));
 
 	return 0;
 }
@@ -522,7 +528,7 @@ tx_t* acxpci_alloc_tx(acx_device_t * adev, int queue_id)
 	log(L_BUFT, "tx: got desc %u, %u remain\n", head, adev->hw_tx_queue[queue_id].free);
 
 	/* returning current descriptor, so advance to next free one */
-	adev->hw_tx_queue[queue_id].head = (head + 1) % TX_CNT;
+	adev->hw_tx_queue[queue_id].head = (head + 1) & adev->tx_mask;
 end:
 
 
@@ -553,21 +559,126 @@ int acxpci_load_firmware(acx_device_t *adev)
 		fw_combined_filename, fw_base_filename, radio_filename
 		);
 
+	/* Images another card already loaded: no need to look for
+	 * the combined file again if we got base + radio */
+	if (!acx_load_firmware(adev, fw_combined_filename, NULL, 1)
+		|| !acx_load_firmware(adev, fw_base_filename,
+				radio_filename, 1))
+		return 0;
+
 	/* First try combined, ... */
-	rc=acx_load_firmware(adev, fw_combined_filename, NULL);
+	rc=acx_load_firmware(adev, fw_combined_filename, NULL, 0);
 	if (!rc)
 		return rc;
 
 	/*... then base + radio image */
-	rc = acx_load_firmware(adev, fw_base_filename, radio_filename);
+	rc = acx_load_firmware(adev, fw_base_filename, radio_filename, 0);
 
 	return rc;
 }
 
-void acxpci_process_rxdesc(acx_device_t *adev)
+/*
+ * Zero-copy rx
+ *
+ * Each rxhostdesc can be backed by a DMA-mapped skb instead of its
+ * slot in the coherent rxbuf area. When a large frame arrives the
+ * desc is refilled with a spare skb from adev->rx_skb_pool and the
+ * filled one is handed to mac80211 as is. Small frames are copied,
+ * so their skb is recycled in place. If no spare skb can be had, we
+ * also copy and keep the skb, so the ring never runs dry.
+ */
+int acxpci_rx_refill(acx_device_t *adev, rxhostdesc_t *hostdesc)
+{
+	struct sk_buff *skb;
+	dma_addr_t phy;
+
+	skb = skb_dequeue(&adev->rx_skb_pool);
+	if (!skb)
+		skb = dev_alloc_skb(RX_BUFFER_SIZE);
+	if (!skb)
+		goto fail;
+
+	phy = dma_map_single(adev->bus_dev, skb->data, RX_BUFFER_SIZE,
+			DMA_FROM_DEVICE);
+	if (unlikely(dma_mapping_error(adev->bus_dev, phy))) {
+		skb_queue_head(&adev->rx_skb_pool, skb);
+		goto fail;
+	}
+
+	hostdesc->skb = skb;
+	hostdesc->skb_phy = phy;
+	hostdesc->data = (rxbuffer_t *) skb->data;
+	hostdesc->hd.data_phy = cpu2acx(phy);
+
+	return OK;
+fail:
+	adev->rx_refill_failures++;
+	return NOT_OK;
+}
+
+/* Top up the spare skbs, outside of the rx descriptor loop. One per
+ * rxdesc, so a full ring can be refilled. */
+static void acxpci_rx_fill_pool(acx_device_t *adev)
+{
+	struct sk_buff *skb;
+
+	while (skb_queue_len(&adev->rx_skb_pool) < adev->rx_cnt) {
+		skb = dev_alloc_skb(RX_BUFFER_SIZE);
+		if (!skb)
+			break;
+		skb_queue_tail(&adev->rx_skb_pool, skb);
+	}
+}
+
+/* Unmap and free all rx skbs, incl. the spare ones */
+void acxpci_rx_free_skbs(acx_device_t *adev)
+{
+	rxhostdesc_t *hostdesc = adev->hw_rx_queue.hostdescinfo.start;
+	int i;
+
+	if (hostdesc)
+		for (i = 0; i < adev->rx_cnt; i++, hostdesc++) {
+			if (!hostdesc->skb)
+				continue;
+			dma_unmap_single(adev->bus_dev, hostdesc->skb_phy,
+					RX_BUFFER_SIZE, DMA_FROM_DEVICE);
+			dev_kfree_skb(hostdesc->skb);
+			hostdesc->skb = NULL;
+			hostdesc->data = NULL;
+		}
+
+	skb_queue_purge(&adev->rx_skb_pool);
+}
+
+static void acxpci_rx_skb(acx_device_t *adev, rxhostdesc_t *hostdesc)
+{
+	struct sk_buff *skb = hostdesc->skb;
+	rxbuffer_t *rxbuf = hostdesc->data;
+	dma_addr_t phy = hostdesc->skb_phy;
+
+	dma_sync_single_for_cpu(adev->bus_dev, phy, RX_BUFFER_SIZE,
+				DMA_FROM_DEVICE);
+
+	if (RXBUF_BYTES_RCVD(adev, rxbuf) <= ACX_RX_COPYBREAK
+		|| acxpci_rx_refill(adev, hostdesc) != OK) {
+		acx_process_rxbuf(adev, rxbuf, NULL);
+		dma_sync_single_for_device(adev->bus_dev, phy,
+					RX_BUFFER_SIZE, DMA_FROM_DEVICE);
+		adev->rx_copybreak_frames++;
+		return;
+	}
+
+	/* hostdesc has a fresh skb now, pass the filled one up */
+	dma_unmap_single(adev->bus_dev, phy, RX_BUFFER_SIZE, DMA_FROM_DEVICE);
+	acx_process_rxbuf(adev, rxbuf, skb);
+	adev->rx_zerocopy_frames++;
+}
+
+void acxpci_process_rxdesc(acx_device_t *adev, unsigned int budget)
 {
 	register rxhostdesc_t *hostdesc;
 	unsigned count, tail;
+	unsigned int done = 0;
 
 	if (unlikely(acx_debug & L_BUFR))
 		acx_log_rxbuffer(adev);
@@ -577,12 +688,12 @@ void acxpci_process_rxdesc(acx_device_t *adev)
 	 * rx_tail and the full descriptor we're supposed to
 	 * handle. */
 	tail = adev->hw_rx_queue.tail;
-	count = RX_CNT;
+	count = adev->rx_cnt;
 	while (1) {
 		hostdesc = &adev->hw_rx_queue.hostdescinfo.start[tail];
 
 		/* advance tail regardless of outcome of the below test */
-		tail = (tail + 1) % RX_CNT;
+		tail = (tail + 1) & adev->rx_mask;
 
 		if ((hostdesc->hd.Ctl_16 & cpu_to_le16(DESC_CTL_HOSTOWN))
 		        && (hostdesc->hd.Status & cpu_to_le32(DESC_STATUS_FULL)))
@@ -598,7 +709,10 @@ void acxpci_process_rxdesc(acx_device_t *adev)
 		log(L_BUF,
 		        "rx: tail=%u Ctl_16=%04X Status=%08X\n", tail, hostdesc->hd.Ctl_16, hostdesc->hd.Status);
 
-		acx_process_rxbuf(adev, hostdesc->data);
+		if (hostdesc->skb)
+			acxpci_rx_skb(adev, hostdesc);
+		else
+			acx_process_rxbuf(adev, hostdesc->data, NULL);
 		hostdesc->hd.Status = 0;
 
 		/* flush all writes before adapter sees CTL_HOSTOWN change */
@@ -615,11 +729,20 @@ void acxpci_process_rxdesc(acx_device_t *adev)
 		        || !(hostdesc->hd.Status & cpu_to_le32(DESC_STATUS_FULL)))
 			break;
 
-		tail = (tail + 1) % RX_CNT;
+		/* budget used up: leave the rest for the next poll */
+		if (budget && ++done >= budget) {
+			adev->rx_poll_pending = 1;
+			break;
+		}
+
+		tail = (tail + 1) & adev->rx_mask;
 	}
 
 	end:
 	adev->hw_rx_queue.tail = tail;
+
+	if (acx_rx_zerocopy)
+		acxpci_rx_fill_pool(adev);
 }
 
 
@@ -862,7 +985,7 @@ int acx111pci_ioctl_info(struct net_device *ndev,
 
 	/* loop over complete receive pool */
 	if (rxdesc)
-		for (i = 0; i < RX_CNT; i++) {
+		for (i = 0; i < adev->rx_cnt; i++) {
 			pr_acx("\ndump internal rxdesc %d:\n"
 			       "mem pos %p\n"
 			       "next 0x%X\n"
@@ -886,7 +1009,7 @@ int acx111pci_ioctl_info(struct net_device *ndev,
 
 	/* loop over complete receive pool */
 	if (rxhostdesc)
-		for (i = 0; i < RX_CNT; i++) {
+		for (i = 0; i < adev->rx_cnt; i++) {
 			pr_acx("\ndump host rxdesc %d:\n"
 			       "mem pos %p\n"
 			       "buffer mem pos 0x%X\n"
@@ -911,7 +1034,7 @@ int acx111pci_ioctl_info(struct net_device *ndev,
 
 	/* loop over complete transmit pool */
 	if (txdesc)
-		for (i = 0; i < TX_CNT; i++) {
+		for (i = 0; i < adev->tx_cnt; i++) {
 			pr_acx("\ndump internal txdesc %d:\n"
 			       "size 0x%X\n"
 			       "mem pos %p\n"
@@ -942,7 +1065,7 @@ int acx111pci_ioctl_info(struct net_device *ndev,
 
 	/* loop over complete host send pool */
 	if (txhostdesc)
-		for (i = 0; i < TX_CNT * 2; i++) {
+		for (i = 0; i < adev->tx_cnt * 2; i++) {
 			pr_acx("\ndump host txdesc %d:\n"
 			       "mem pos %p\n"
 			       "buffer mem pos 0x%X\n"
@@ -1092,6 +1215,11 @@ static int acxpci_probe(struct pci_dev *pdev,
 	/* Specify DMA mask 30-bit. Problem was triggered from
 	 * >=2.6.33 on x86_64 */
 	adev->bus_dev->coherent_dma_mask = DMA_BIT_MASK(30);
+	/* Same limit for streaming mappings (zero-copy tx) */
+	if (dma_set_mask(adev->bus_dev, DMA_BIT_MASK(30)))
+		pr_acx("no usable 30-bit DMA mask, disabling zero-copy tx\n");
+	else
+		adev->tx_zerocopy = 1;
 
 	/* chiptype is u8 but id->driver_data is ulong Works for now
 	 * (possible values are 1 and 2) */
@@ -1424,6 +1552,7 @@ static int acxpci_e_suspend(struct pci_dev *pdev, pm_message_t state)
 
 	acx_sem_lock(adev);
 
+	acx_cfg_snapshot(adev);
 	ieee80211_unregister_hw(hw);	/* this one cannot sleep */
 	/* OW 20100603 FIXME acx_down(hw); */
 	/* down() does not set it to 0xffff, but here we really want that */
@@ -1442,6 +1571,7 @@ static int acxpci_e_resume(struct pci_dev *pdev)
 {
 	struct ieee80211_hw *hw = pci_get_drvdata(pdev);
 	acx_device_t *adev;
+	ktime_t t0 = ktime_get(), t1;
 
 
 
@@ -1459,17 +1589,16 @@ static int acxpci_e_resume(struct pci_dev *pdev)
 	pci_restore_state(pdev);
 	pr_acx("rsm: PCI state restored\n");
 
-	if (OK != acx_reset_dev(adev))
+	if (OK != acx_resume_hw(adev))
 		goto end_unlock;
-	pr_acx("rsm: device reset done\n");
-	if (OK != acx_init_mac(adev))
-		goto end_unlock;
-	pr_acx("rsm: init MAC done\n");
-
-	//acx_up(hw);
-	pr_acx("rsm: acx up done\n");
+	pr_acx("rsm: device reset and settings restored\n");
 
+	t1 = ktime_get();
 	ieee80211_register_hw(hw);
+	adev->resume_ns[ACX_RESUME_REGISTER] =
+		ktime_to_ns(ktime_sub(ktime_get(), t1));
+	adev->resume_ns[ACX_RESUME_TOTAL] =
+		ktime_to_ns(ktime_sub(ktime_get(), t0));
 	pr_acx("rsm: device attached\n");
 
       end_unlock:
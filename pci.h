@@ -15,7 +15,9 @@ int acxpci_dbgfs_diag_output(struct seq_file *file, acx_device_t *adev);
 
 #if defined(CONFIG_ACX_MAC80211_PCI)
 
-void acxpci_process_rxdesc(acx_device_t *adev);
+void acxpci_process_rxdesc(acx_device_t *adev, unsigned int budget);
+int acxpci_rx_refill(acx_device_t *adev, rxhostdesc_t *hostdesc);
+void acxpci_rx_free_skbs(acx_device_t *adev);
 
 void acxpci_reset_mac(acx_device_t *adev);
 int acxpci_load_firmware(acx_device_t *adev);
@@ -25,7 +27,11 @@ void __exit acxpci_cleanup_module(void);
 
 #else /* !CONFIG_ACX_MAC80211_PCI */
 
-static inline void acxpci_process_rxdesc(acx_device_t *adev) {}
+static inline void acxpci_process_rxdesc(acx_device_t *adev,
+					unsigned int budget) {}
+static inline int acxpci_rx_refill(acx_device_t *adev,
+				rxhostdesc_t *hostdesc) { return NOT_OK; }
+static inline void acxpci_rx_free_skbs(acx_device_t *adev) {}
 
 static inline int __init acxpci_init_module(void) { return 0; }
 static inline void __exit acxpci_cleanup_module(void) { }
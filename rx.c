@@ -24,6 +24,7 @@
 #include "merge.h"
 #include "usb.h"
 #include "utils.h"
+#include "main.h"
 #include "rx.h"
 
 /*
@@ -109,34 +110,45 @@ const char* acx_get_packet_type_string(u16 fc)
  *
  * The end of the Rx path. Pulls data from a rxhostdesc into a socket
  * buffer and feeds it to the network stack via netif_rx().
+ *
+ * If skb is given, rxbuf lives at skb->data (PCI zero-copy rx) and
+ * the skb is passed up as is, minus the acx rx header.
  */
-static void acx_rx(acx_device_t *adev, rxbuffer_t *rxbuf)
+static void acx_rx(acx_device_t *adev, rxbuffer_t *rxbuf,
+		struct sk_buff *skb)
 {
 	struct ieee80211_rx_status *status;
 
 	struct ieee80211_hdr *w_hdr;
-	struct sk_buff *skb;
 	int buflen;
 	int level;
 
 	if (unlikely(!test_bit(ACX_FLAG_HW_UP, &adev->flags))) {
 		pr_info("asked to receive a packet while hw down\n");
+		if (skb)
+			dev_kfree_skb(skb);
 		return;
 	}
 
 	w_hdr = acx_get_wlan_hdr(adev, rxbuf);
 	buflen = RXBUF_BYTES_RCVD(adev, rxbuf);
 
-	/* Allocate our skb */
-	skb = dev_alloc_skb(buflen);
-	if (!skb) {
-		pr_info("skb allocation FAILED\n");
-		return;
+	if (skb) {
+		/* rxbuf header fields stay readable in the headroom */
+		skb_reserve(skb, (u8 *) w_hdr - skb->data);
+		skb_put(skb, buflen);
+	} else {
+		/* Allocate our skb */
+		skb = dev_alloc_skb(buflen);
+		if (!skb) {
+			pr_info("skb allocation FAILED\n");
+			return;
+		}
+
+		skb_put(skb, buflen);
+		memcpy(skb->data, w_hdr, buflen);
 	}
 
-	skb_put(skb, buflen);
-	memcpy(skb->data, w_hdr, buflen);
-
 	status = IEEE80211_SKB_RXCB(skb);
 	memset(status, 0, sizeof(*status));
 
@@ -171,7 +183,11 @@ static void acx_rx(acx_device_t *adev, rxbuffer_t *rxbuf)
 			acx_plcp_get_bitrate_cck(rxbuf->phy_plcp_signal);
 #endif
 
-	if (IS_PCI(adev)) {
+	/* Budgeted rx poll: hand up the whole list in
+	 * acx_rx_deliver_list(), after the acx lock is dropped */
+	if (adev->rx_polling)
+		__skb_queue_tail(&adev->rx_poll_list, skb);
+	else if (IS_PCI(adev)) {
 #if CONFIG_ACX_MAC80211_VERSION <= KERNEL_VERSION(2, 6, 32)
 		local_bh_disable();
 		ieee80211_rx(adev->hw, skb);
@@ -186,8 +202,8 @@ static void acx_rx(acx_device_t *adev, rxbuffer_t *rxbuf)
 	else
 		logf0(L_ANY, "ERROR: Undefined device type !?\n");
 
-	adev->stats.rx_packets++;
-	adev->stats.rx_bytes += skb->len;
+	acx_stats_rx(adev, buflen);
+	adev->rx_coal_frames++;
 
 }
 
@@ -195,8 +211,12 @@ static void acx_rx(acx_device_t *adev, rxbuffer_t *rxbuf)
  * acx_l_process_rxbuf
  *
  * NB: used by USB code also
+ *
+ * skb is the buffer rxbuf lives in when it can be handed up without
+ * copying, NULL otherwise.
  */
-void acx_process_rxbuf(acx_device_t *adev, rxbuffer_t *rxbuf)
+void acx_process_rxbuf(acx_device_t *adev, rxbuffer_t *rxbuf,
+		struct sk_buff *skb)
 {
 	struct ieee80211_hdr *hdr;
 	u16 fc, buf_len;
@@ -232,13 +252,14 @@ void acx_process_rxbuf(acx_device_t *adev, rxbuffer_t *rxbuf)
 		acx_dump_bytes(hdr, buf_len);
 	}
 
-	acx_rx(adev, rxbuf);
-
-	/* Now check Rx quality level, AFTER processing packet.  I
-	 * tried to figure out how to map these levels to dBm values,
-	 * but for the life of me I really didn't manage to get
-	 * it. Either these values are not meant to be expressed in
-	 * dBm, or it's some pretty complicated calculation. */
+	/* Now check Rx quality level.  I tried to figure out how to
+	 * map these levels to dBm values, but for the life of me I
+	 * really didn't manage to get it. Either these values are not
+	 * meant to be expressed in dBm, or it's some pretty
+	 * complicated calculation.
+	 *
+	 * Done before acx_rx(), since that may hand rxbuf's skb
+	 * away. */
 
 	/* FIXME OW 20100619 Is this still required. Only for adev local use.
 	 * Mac80211 signal level is reported in acx_l_rx for each skb.
@@ -246,7 +267,30 @@ void acx_process_rxbuf(acx_device_t *adev, rxbuffer_t *rxbuf)
 	/* TODO: only the RSSI seems to be reported */
 	adev->rx_status.signal = acx_signal_to_winlevel(rxbuf->phy_level);
 
+	acx_rx(adev, rxbuf, skb);
+
+}
+
+/*
+ * acx_rx_deliver_list
+ *
+ * Hands the frames queued by a budgeted rx poll to mac80211, with
+ * bottom halves disabled once for the whole list instead of once
+ * per frame. Called without the acx spinlock held.
+ */
+void acx_rx_deliver_list(acx_device_t *adev)
+{
+	struct sk_buff *skb;
 
+	if (skb_queue_empty(&adev->rx_poll_list))
+		return;
+
+	local_bh_disable();
+	while ((skb = __skb_dequeue(&adev->rx_poll_list))) {
+		ieee80211_rx(adev->hw, skb);
+		adev->rx_poll_frames++;
+	}
+	local_bh_enable();
 }
 
 /* TODO Verify these functions: translation rxbuffer.phy_plcp_signal to rate_idx */
@@ -1,7 +1,9 @@
 #ifndef _ACX_RX_H_
 #define _ACX_RX_H_
 
-void acx_process_rxbuf(acx_device_t *adev, rxbuffer_t *rxbuf);
+void acx_process_rxbuf(acx_device_t *adev, rxbuffer_t *rxbuf,
+		struct sk_buff *skb);
+void acx_rx_deliver_list(acx_device_t *adev);
 u8 acx_signal_determine_quality(u8 signal, u8 noise);
 
 #if !ACX_DEBUG
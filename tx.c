@@ -26,22 +26,140 @@
 #include "main.h"
 #include "tx.h"
 
-static int acx_is_hw_tx_queue_stop_limit(acx_device_t *adev)
+/*
+ * Hw tx queue for a frame of access category ac
+ *
+ * Unencrypted frames (e.g. mgmt- and eapol-frames) go on
+ * NOENC_QUEUE_ID. On the acx111, encrypted frames get one hw queue
+ * per AC, queue 1 for VO up to 4 for BK, matching the descending
+ * queue attributes set in the memory config. USB has a single pool
+ * of tx urbs.
+ *
+ * With hw-encyption disabled, all is sent on the NOENC queue. This
+ * is required, if the was previously used using hw-encyption: once a
+ * queue was used, if will not stop encryption, and so the current
+ * solution is to avoid the encrypting queues entirely.
+ */
+static int acx_tx_queue_id(acx_device_t *adev, struct sk_buff *skb, int ac)
 {
-	int i;
-	for (i=0; i<adev->num_hw_tx_queues; i++)
-	{
-		if (adev->hw_tx_queue[i].free < TX_STOP_QUEUE)
-		{
-			logf1(L_BUF, "Tx_free < TX_STOP_QUEUE (queue_id=%d: %u tx desc left):"
-				" Stop queue.\n", i, adev->hw_tx_queue[i].free);
-			return 1;
-		}
+	struct ieee80211_hdr *hdr = (struct ieee80211_hdr *) skb->data;
+
+	if (IS_USB(adev) || !adev->hw_encrypt_enabled
+		|| !(hdr->frame_control & IEEE80211_FCTL_PROTECTED))
+		return NOENC_QUEUE_ID;
+
+	if (adev->num_hw_tx_queues > ACX_NUM_ACS)
+		return 1 + ac;
+
+	/* acx100: a single hw queue for everything */
+	return adev->num_hw_tx_queues - 1;
+}
+
+static unsigned int acx_tx_ring_len(acx_device_t *adev)
+{
+#ifdef CONFIG_ACX_MAC80211_USB
+	if (IS_USB(adev))
+		return adev->usb_tx_cnt;
+#endif
+	return adev->tx_cnt;
+}
+
+/* Free descs of a hw queue. The USB tx urb slots are counted
+ * lock-free, see acxusb_alloc_tx() */
+unsigned int acx_tx_queue_free(acx_device_t *adev, int queue_id)
+{
+#ifdef CONFIG_ACX_MAC80211_USB
+	if (IS_USB(adev))
+		return atomic_read(&adev->usb_tx_free);
+#endif
+	return adev->hw_tx_queue[queue_id].free;
+}
+
+/*
+ * Per hw queue flow control thresholds, from the txstop and txstart
+ * module params. A queue is stopped below the stop limit and woken
+ * again at the start limit. Both are clamped to the ring, and
+ * start >= stop keeps the hysteresis.
+ */
+static unsigned int acx_tx_stop_limit(acx_device_t *adev)
+{
+	return clamp_t(unsigned int, acx_tx_stop_queue, 1,
+		acx_tx_ring_len(adev) - 1);
+}
+
+static unsigned int acx_tx_start_limit(acx_device_t *adev)
+{
+	return clamp_t(unsigned int, acx_tx_start_queue,
+		acx_tx_stop_limit(adev), acx_tx_ring_len(adev));
+}
+
+/* Keep a few free descs between head and tail of tx ring. It is not
+ * absolutely needed, just feels safer */
+static int acx_is_hw_tx_queue_stop_limit(acx_device_t *adev, int queue_id)
+{
+	unsigned int free = acx_tx_queue_free(adev, queue_id);
+
+	if (free < acx_tx_stop_limit(adev)) {
+		logf1(L_BUF, "Tx_free < stop limit (queue_id=%d: %u tx desc left):"
+			" Stop queue.\n", queue_id, free);
+		return 1;
 	}
 
 	return 0;
 }
 
+/*
+ * Stop AC ac, until hw queue queue_id has room again.
+ *
+ * On USB, acx_tx_wake_hw_queue() runs from the urb completion without
+ * the sem. The bit is set before the queue is stopped, and the free
+ * count re-read after, so descs freed meanwhile can't miss the wake.
+ */
+static void acx_tx_stop_hw_queue(acx_device_t *adev, int queue_id, int ac)
+{
+	struct hw_tx_queue *hwq = &adev->hw_tx_queue[queue_id];
+
+	if (!test_and_set_bit(ac, &hwq->stopped_acs))
+		atomic_inc(&hwq->stops);
+	acx_stop_ac_queue(adev->hw, ac, NULL);
+
+	smp_mb();
+	if (acx_tx_queue_free(adev, queue_id) >= acx_tx_start_limit(adev))
+		acx_tx_wake_hw_queue(adev, queue_id);
+}
+
+/*
+ * Called after tx descs of queue_id were freed: wakes the ACs stopped
+ * on this queue, once it is back at the start limit. ACs waiting on
+ * other hw queues stay stopped.
+ */
+void acx_tx_wake_hw_queue(acx_device_t *adev, int queue_id)
+{
+	struct hw_tx_queue *hwq = &adev->hw_tx_queue[queue_id];
+	unsigned int free = acx_tx_queue_free(adev, queue_id);
+	int ac, woken = 0;
+
+	if (!hwq->stopped_acs || free < acx_tx_start_limit(adev))
+		return;
+
+	for (ac = 0; ac < ACX_NUM_ACS; ac++) {
+		if (!test_and_clear_bit(ac, &hwq->stopped_acs))
+			continue;
+		ieee80211_wake_queue(adev->hw, ac);
+		woken++;
+	}
+	if (!woken)
+		return;
+
+	atomic_inc(&hwq->wakes);
+	log(L_BUF, "tx: wake queue_id=%d (%u tx desc free)\n",
+		queue_id, free);
+
+	/* Schedule the tx, since it doesn't harm. Required in case of
+	 * irq-iteration. */
+	ieee80211_queue_work(adev->hw, &adev->tx_work);
+}
+
 static void acx_dealloc_tx(acx_device_t *adev, tx_t *tx_opaque)
 {
 	if (IS_USB(adev))
@@ -79,6 +197,16 @@ static void acx_tx_data(acx_device_t *adev, tx_t *tx_opaque, int len,
 	return;
 }
 
+/* Returns OK if the hw can take the frame straight from the skb */
+static int acx_tx_map_skb(acx_device_t *adev, tx_t *tx_opaque,
+			struct sk_buff *skb, int q)
+{
+	if (IS_PCI(adev))
+		return _acx_tx_map_skb(adev, tx_opaque, skb, q);
+
+	return NOT_OK;
+}
+
 /*
  * OW Included skb->len to check required blocks upfront in
  * acx_l_alloc_tx This should perhaps also go into pci and usb ?
@@ -96,29 +224,14 @@ static tx_t* acx_alloc_tx(acx_device_t *adev, unsigned int len, int q)
 	return (NULL);
 }
 
-static int acx_tx_frame(acx_device_t *adev, struct sk_buff *skb)
+static int acx_tx_frame(acx_device_t *adev, struct sk_buff *skb,
+			int queue_id)
 {
 	tx_t *tx;
 	void *txbuf;
 	struct ieee80211_tx_info *ctl;
-	struct ieee80211_hdr *hdr;
-
-	/* Default queue_id for data-frames */
-	int queue_id=1;
 
 	ctl = IEEE80211_SKB_CB(skb);
-	hdr = (struct ieee80211_hdr*) skb->data;
-
-	/* Sent unencrypted frames (e.g. mgmt- and eapol-frames) on NOENC_QUEUE_ID */
-	if (!(hdr->frame_control & IEEE80211_FCTL_PROTECTED))
-		queue_id=NOENC_QUEUE_ID;
-
-	/* With hw-encyption disabled, sent all on the NOENC queue.
-	 * This is required, if the was previously used using hw-encyption:
-	 * once a queue was used, if will not stop encryption, and so the
-	 * current solution is to avoid the encrypting queues entirely. */
-	if (!adev->hw_encrypt_enabled)
-		queue_id=NOENC_QUEUE_ID;
 
 	tx = acx_alloc_tx(adev, skb->len, queue_id);
 
@@ -142,12 +255,12 @@ static int acx_tx_frame(acx_device_t *adev, struct sk_buff *skb)
 	/* FIXME: Is this required for mem ? txbuf is actually not containing to the data
 	 * for the device, but actually "addr = acxmem_allocate_acx_txbuf_space in acxmem_tx_data().
 	 */
-	memcpy(txbuf, skb->data, skb->len);
+	if (acx_tx_map_skb(adev, tx, skb, queue_id) != OK)
+		memcpy(txbuf, skb->data, skb->len);
 
-	acx_tx_data(adev, tx, skb->len, ctl, skb, queue_id);
+	acx_stats_tx(adev, skb->len, queue_id, ctl->control.rates[0].idx);
 
-	adev->stats.tx_packets++;
-	adev->stats.tx_bytes += skb->len;
+	acx_tx_data(adev, tx, skb->len, ctl, skb, queue_id);
 
 	return 0;
 }
@@ -156,16 +269,19 @@ void acx_tx_queue_flush(acx_device_t *adev)
 {
 	struct sk_buff *skb;
 	struct ieee80211_tx_info *info;
+	int ac;
 
-	while ((skb = skb_dequeue(&adev->tx_queue))) {
-		info = IEEE80211_SKB_CB(skb);
+	for (ac = 0; ac < ACX_NUM_ACS; ac++) {
+		while ((skb = skb_dequeue(&adev->tx_queue[ac]))) {
+			info = IEEE80211_SKB_CB(skb);
 
-		logf1(L_BUF, "Flushing skb 0x%p", skb);
+			logf1(L_BUF, "Flushing skb 0x%p", skb);
 
-		if (!(info->flags & IEEE80211_TX_CTL_REQ_TX_STATUS))
-			continue;
+			if (!(info->flags & IEEE80211_TX_CTL_REQ_TX_STATUS))
+				continue;
 
-		ieee80211_tx_status(adev->hw, skb);
+			ieee80211_tx_status(adev->hw, skb);
+		}
 	}
 }
 
@@ -178,13 +294,33 @@ void acx_stop_queue(struct ieee80211_hw *hw, const char *msg)
 
 }
 
+/* Stops a single AC, the others keep going */
+void acx_stop_ac_queue(struct ieee80211_hw *hw, int ac, const char *msg)
+{
+	ieee80211_stop_queue(hw, ac);
+	if (msg)
+		log(L_BUFT, "tx: stop queue %d %s\n", ac, msg);
+}
+
+/* Returns true if any of the AC queues is stopped */
 int acx_queue_stopped(struct ieee80211_hw *ieee)
 {
-	return ieee80211_queue_stopped(ieee, 0);
+	int ac;
+
+	for (ac = 0; ac < ieee->queues; ac++)
+		if (ieee80211_queue_stopped(ieee, ac))
+			return 1;
+
+	return 0;
 }
 
 void acx_wake_queue(struct ieee80211_hw *hw, const char *msg)
 {
+	acx_device_t *adev = hw2adev(hw);
+	int i;
+
+	for (i = 0; i < ACX111_MAX_NUM_HW_TX_QUEUES; i++)
+		adev->hw_tx_queue[i].stopped_acs = 0;
 
 	ieee80211_wake_queues(hw);
 	if (msg)
@@ -486,20 +622,84 @@ void acx_tx_work(struct work_struct *work)
 }
 
 
+/* Max frames per tx batch, 0/1 when batching is off */
+unsigned int acx_tx_batch_limit(acx_device_t *adev)
+{
+	if (IS_USB(adev))
+		return min_t(unsigned int, acx_usb_tx_agg, ACX_TX_URB_MAX);
+	if (acx_tx_batch < 0)
+		return adev->tx_cnt;
+	return acx_tx_batch;
+}
+
+static void acx_tx_batch_kick(acx_device_t *adev)
+{
+	if (IS_USB(adev))
+		acxusb_tx_kick(adev);
+	else
+		acx_tx_kick(adev);
+}
+
+/*
+ * Next frame to send: from the highest priority AC that has frames
+ * and room in its hw queue. ACs whose hw queue is full are stopped
+ * and skipped, so a full BK queue doesn't hold back VO.
+ */
+static struct sk_buff *acx_tx_dequeue(acx_device_t *adev,
+				unsigned long *busy, int *ac, int *queue_id)
+{
+	struct sk_buff *skb;
+
+	for (*ac = 0; *ac < ACX_NUM_ACS; (*ac)++) {
+		if (test_bit(*ac, busy))
+			continue;
+
+		skb = skb_peek(&adev->tx_queue[*ac]);
+		if (!skb)
+			continue;
+
+		*queue_id = acx_tx_queue_id(adev, skb, *ac);
+		if (acx_is_hw_tx_queue_stop_limit(adev, *queue_id)) {
+			acx_tx_stop_hw_queue(adev, *queue_id, *ac);
+			__set_bit(*ac, busy);
+			continue;
+		}
+
+		return skb_dequeue(&adev->tx_queue[*ac]);
+	}
+
+	return NULL;
+}
+
+/*
+ * Pushes queued skbs to the hw as long as there are free txdescs.
+ *
+ * On PCI and MEM the txdescs are filled in batches of up to
+ * acx_tx_batch_limit() frames and the acx is told about each batch
+ * with a single TXPRC doorbell (see acx_tx_kick()), instead of one
+ * write_reg16() plus write_flush() per frame. On USB, with txagg
+ * set, the frames of a batch share one bulk-out urb instead (see
+ * acxusb_tx_kick()).
+ */
 void acx_tx_queue_go(acx_device_t *adev)
 {
 	struct sk_buff *skb;
+	unsigned long busy = 0;	/* ACs with a full hw queue */
+	int ac, queue_id;
 	int ret;
 
-	while ((skb = skb_dequeue(&adev->tx_queue))) {
+	adev->tx_batching = acx_tx_batch_limit(adev) > 1;
 
-		ret = acx_tx_frame(adev, skb);
+	while ((skb = acx_tx_dequeue(adev, &busy, &ac, &queue_id))) {
+
+		ret = acx_tx_frame(adev, skb, queue_id);
 
 		if (ret == -EBUSY) {
-			logf0(L_BUFT, "EBUSY: Stop queue. Requeuing skb.\n");
-			acx_stop_queue(adev->hw, NULL);
-			skb_queue_head(&adev->tx_queue, skb);
-			goto out;
+			logf1(L_BUFT, "EBUSY: Stop queue %d. Requeuing skb.\n", ac);
+			acx_tx_stop_hw_queue(adev, queue_id, ac);
+			skb_queue_head(&adev->tx_queue[ac], skb);
+			__set_bit(ac, &busy);
+			continue;
 		} else if (ret < 0) {
 			logf0(L_BUF, "Other ERR: (Card was removed ?!):"
 				" Stop queue. Dealloc skb.\n");
@@ -508,16 +708,20 @@ void acx_tx_queue_go(acx_device_t *adev)
 			goto out;
 		}
 
-		/* Keep a few free descs between head and tail of tx
-		 * ring. It is not absolutely needed, just feels
-		 * safer */
-		if (acx_is_hw_tx_queue_stop_limit(adev))
-		{
-			acx_stop_queue(adev->hw, NULL);
-			goto out;
-		}
+		/* Room again in the sw queue, see acx_op_tx(). ACs
+		 * waiting for a hw queue are woken on tx completion */
+		if (skb_queue_len(&adev->tx_queue[ac]) < ACX_TX_QUEUE_MAX_LENGTH
+			&& ieee80211_queue_stopped(adev->hw, ac)
+			&& !test_bit(ac, &adev->hw_tx_queue[queue_id].stopped_acs))
+			ieee80211_wake_queue(adev->hw, ac);
+
+		if (adev->tx_batch_pending >= acx_tx_batch_limit(adev))
+			acx_tx_batch_kick(adev);
 	}
 out:
+	adev->tx_batching = 0;
+	acx_tx_batch_kick(adev);
+
 	return;
 }
 
@@ -3,6 +3,9 @@
 
 void acx_tx_queue_flush(acx_device_t *adev);
 void acx_stop_queue(struct ieee80211_hw *hw, const char *msg);
+void acx_stop_ac_queue(struct ieee80211_hw *hw, int ac, const char *msg);
+void acx_tx_wake_hw_queue(acx_device_t *adev, int queue_id);
+unsigned int acx_tx_queue_free(acx_device_t *adev, int queue_id);
 int acx_queue_stopped(struct ieee80211_hw *ieee);
 void acx_wake_queue(struct ieee80211_hw *hw, const char *msg);
 
@@ -18,6 +21,7 @@ void acxpcimem_handle_tx_error(acx_device_t *adev, u8 error,
 			unsigned int finger,
 			struct ieee80211_tx_info *info);
 
+unsigned int acx_tx_batch_limit(acx_device_t *adev);
 void acx_tx_work(struct work_struct *work);
 void acx_tx_queue_go(acx_device_t *adev);
 
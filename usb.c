@@ -130,10 +130,6 @@ MODULE_DEVICE_TABLE(usb, acxusb_ids);
 /* Buffer size for fw upload, same for both ACX100 USB and TNETW1450 */
 #define USB_RWMEM_MAXLEN	2048
 
-/* The number of bulk URBs to use */
-#define ACX_TX_URB_CNT		8
-#define ACX_RX_URB_CNT		2
-
 /* Should be sent to the bulkout endpoint */
 #define ACX_USB_REQ_UPLOAD_FW	0x10
 #define ACX_USB_REQ_ACK_CS	0x11
@@ -295,7 +291,7 @@ acxusb_boot(struct usb_device *usbdev, int is_tnetw1450, int *radio_type)
 	snprintf(filename, sizeof(filename), "tiacx1%02dusbc%02X",
 		 is_tnetw1450 * 11, *radio_type);
 
-	fw_image = acx_read_fw(&usbdev->dev, filename, &file_size);
+	fw_image = acx_get_fw(&usbdev->dev, filename, &file_size, 0);
 	if (!fw_image) {
 		result = -EIO;
 		goto end;
@@ -485,7 +481,7 @@ acxusb_boot(struct usb_device *usbdev, int is_tnetw1450, int *radio_type)
 	}
 
       end:
-	vfree(fw_image);
+	acx_put_fw(fw_image);
 	kfree(usbbuf);
 
 
@@ -827,6 +823,7 @@ static void dump_device_descriptor(struct usb_device_descriptor *dd)
  * USB receive is triggered.
  */
 static void acxusb_poll_rx(acx_device_t * adev, usb_rx_t * rx);
+static int acxusb_free_tx_slot(acx_device_t *adev, usb_tx_t *tx);
 static void acxusb_complete_rx(struct urb *urb)
 {
 	acx_device_t *adev;
@@ -834,6 +831,7 @@ static void acxusb_complete_rx(struct urb *urb)
 	rxbuffer_t *inbuf;
 	usb_rx_t *rx;
 	int size, remsize, packetsize, rxnum;
+	int in_flight, in_order;
 	usb_tx_t *tx;
 	struct sk_buff *skb;
 	struct ieee80211_tx_info *txstatus;
@@ -845,6 +843,7 @@ static void acxusb_complete_rx(struct urb *urb)
 
 	rx = (usb_rx_t *) urb->context;
 	adev = rx->adev;
+	in_flight = atomic_dec_return(&adev->usb_rx_inflight);
 
 	// OW, 20100613: A urb call-back is done in_interrupt(), therefore
 	// I could image, that no locking is actually required
@@ -865,13 +864,19 @@ static void acxusb_complete_rx(struct urb *urb)
 	remsize = size;
 	rxnum = rx - adev->usb_rx;
 
-	log(L_USBRXTX, "acxusb: RETURN RX (%d) status=%d size=%d\n",
-		rxnum, urb->status, size);
+	log(L_USBRXTX, "acxusb: RETURN RX (%d) status=%d size=%d "
+		"in flight=%d\n", rxnum, urb->status, size, in_flight);
+
+	/* The other rx urbs keep the bulk-in pipe busy while we
+	 * process this one, it's resubmitted when we're done with
+	 * its buffer. If none is left, the pipe went idle. */
+	if (unlikely(in_flight == 0))
+		adev->usb_rx_starved++;
 
-	/* Send the URB that's waiting. */
-	log(L_USBRXTX, "acxusb: rxnum=%d, sending=%d\n",
-		rxnum, rxnum ^ 1);
-	acxusb_poll_rx(adev, &adev->usb_rx[rxnum ^ 1]);
+	/* Bulk-in urbs complete in submit order, which the
+	 * rxtruncbuf reassembly below relies on. */
+	in_order = (rx->seq == adev->usb_rx_seq_expect);
+	adev->usb_rx_seq_expect = rx->seq + 1;
 
 	if (unlikely(size > sizeof(rxbuffer_t)))
 		log(L_USBRXTX, "acxusb: rx too large: %d, please report\n", size);
@@ -883,7 +888,7 @@ static void acxusb_complete_rx(struct urb *urb)
 	case -EOVERFLOW:
 		pr_err("rx data overrun\n");
 		adev->rxtruncsize = 0;	/* Not valid anymore. */
-		return;
+		goto resubmit;
 	case -ECONNRESET:
 		adev->rxtruncsize = 0;
 		return;
@@ -891,17 +896,26 @@ static void acxusb_complete_rx(struct urb *urb)
 		adev->rxtruncsize = 0;
 		return;
 	default:
+		/* Unplug or a stalled endpoint, resubmitting from here
+		 * would just spin on the error. The urb leaves the ring. */
 		adev->rxtruncsize = 0;
 		adev->stats.rx_errors++;
+		adev->usb_rx_lost++;
 		pr_acx("rx error (urb status=%d)\n", urb->status);
 		return;
 	}
 
+	if (unlikely(!in_order)) {
+		/* a truncated frame can't be continued from here */
+		adev->usb_rx_misordered++;
+		adev->rxtruncsize = 0;
+	}
+
 	if (unlikely(!size))
 		pr_acx("warning, encountered zerolength rx packet\n");
 
 	if (urb->transfer_buffer != inbuf)
-		return;
+		goto resubmit;
 
 	/* check if previous frame was truncated
 	 ** FIXME: this code can only handle truncation
@@ -948,7 +962,7 @@ static void acxusb_complete_rx(struct urb *urb)
 				pr_acxusb("full trailing packet + 12 bytes:\n");
 				acx_dump_bytes(inbuf, tail_size + RXBUF_HDRSIZE);
 			}
-			acx_process_rxbuf(adev, ptr);
+			acx_process_rxbuf(adev, ptr, NULL);
 			adev->rxtruncsize = 0;
 			ptr = (rxbuffer_t *) (((char *)inbuf) + tail_size);
 			remsize -= tail_size;
@@ -991,6 +1005,11 @@ static void acxusb_complete_rx(struct urb *urb)
 					stat->ack_failures, stat->rts_failures,
 					stat->rts_ok);
 
+		if (unlikely(stat->hostdata >= adev->usb_tx_cnt)) {
+			pr_acxusb("tx status for bad urb %u\n",
+				stat->hostdata);
+			goto next;
+		}
             tx = (usb_tx_t*) (adev->usb_tx + stat->hostdata);
             skb = tx->skb;
 		txstatus = IEEE80211_SKB_CB(skb);
@@ -1003,15 +1022,8 @@ static void acxusb_complete_rx(struct urb *urb)
 		// report upstream
 		ieee80211_tx_status(adev->hw, skb);
 
-		tx->busy = 0;
-		adev->hw_tx_queue[0].free++;
-
-		if ((adev->hw_tx_queue[0].free >= TX_START_QUEUE) && acx_queue_stopped(adev->hw)) {
-			log(L_BUF, "tx: wake queue (avail. Tx desc %u)\n",
-				adev->hw_tx_queue[0].free);
-			acx_wake_queue(adev->hw, NULL);
-			ieee80211_queue_work(adev->hw, &adev->tx_work);
-		}
+		acxusb_free_tx_slot(adev, tx);
+		acx_tx_wake_hw_queue(adev, 0);
 
 			goto next;
 		}
@@ -1042,7 +1054,7 @@ static void acxusb_complete_rx(struct urb *urb)
 
 		/* packetsize <= remsize */
 		/* now handle the received data */
-		acx_process_rxbuf(adev, ptr);
+		acx_process_rxbuf(adev, ptr, NULL);
 
 		next:
 		ptr = (rxbuffer_t *) (((char *)ptr) + packetsize);
@@ -1055,6 +1067,9 @@ static void acxusb_complete_rx(struct urb *urb)
 
 	}
 
+	resubmit:
+	/* Buffer is processed, queue the urb again */
+	acxusb_poll_rx(adev, rx);
 }
 
 /*
@@ -1094,9 +1109,20 @@ static void acxusb_poll_rx(acx_device_t * adev, usb_rx_t * rx)
 	    );
 	rxurb->transfer_flags = URB_ASYNC_UNLINK;
 
+	/* The seq is only taken by a successful submit, a failed one
+	 * must not leave a gap for complete_rx() to trip over */
+	rx->seq = adev->usb_rx_seq_submit;
+	atomic_inc(&adev->usb_rx_inflight);
+
 	/* ATOMIC: we may be called from complete_rx() usb callback */
 	errcode = usb_submit_urb(rxurb, GFP_ATOMIC);
-	/* FIXME: evaluate the error code! */
+	if (likely(!errcode))
+		adev->usb_rx_seq_submit++;
+	else {
+		atomic_dec(&adev->usb_rx_inflight);
+		adev->usb_rx_lost++;
+		pr_acx("rx urb %d lost, submit failed: %d\n", rxnum, errcode);
+	}
 	log(L_USBRXTX,
 		"acx: SUBMIT RX (%d) inpipe=0x%X size=%d errcode=%d\n",
 		rxnum, inpipe, (int)RXBUFSIZE, errcode);
@@ -1169,36 +1195,62 @@ static void acxusb_complete_tx(struct urb *urb)
 
 }
 
+/*
+ * Tx urb slots
+ *
+ * Free usb_tx[] slots are the set bits of adev->usb_tx_free_map.
+ * Slots are taken in the tx path and given back from the rx urb
+ * completion (tx status), so both sides only use atomic bitops and
+ * no lock. The queue stop logic in tx.c reads the free count from
+ * usb_tx_free, hw_tx_queue[0].free isn't used on USB.
+ */
+static void acxusb_reset_tx_slots(acx_device_t *adev)
+{
+	int i;
+
+	for (i = 0; i < adev->usb_tx_cnt; i++)
+		adev->usb_tx[i].urb->status = 0;
+
+	adev->usb_tx_free_map = (adev->usb_tx_cnt == BITS_PER_LONG) ?
+		~0UL : (1UL << adev->usb_tx_cnt) - 1;
+	atomic_set(&adev->usb_tx_free, adev->usb_tx_cnt);
+}
+
+/* Returns the number of free slots after freeing */
+static int acxusb_free_tx_slot(acx_device_t *adev, usb_tx_t *tx)
+{
+	unsigned int txnum = tx - adev->usb_tx;
+
+	if (unlikely(test_and_set_bit(txnum, &adev->usb_tx_free_map))) {
+		pr_acxusb("tx urb %u freed twice\n", txnum);
+		return atomic_read(&adev->usb_tx_free);
+	}
+
+	return atomic_inc_return(&adev->usb_tx_free);
+}
+
 /*
  * acxusb_alloc_tx
  * Actually returns a usb_tx_t* ptr
  */
 tx_t *acxusb_alloc_tx(acx_device_t *adev)
 {
-	usb_tx_t *tx;
-	unsigned head;
-
-
+	unsigned long map;
+	unsigned int txnum;
 
-	head =adev->hw_tx_queue[0].head;
 	do {
-		head = (head + 1) % ACX_TX_URB_CNT;
-		if (!adev->usb_tx[head].busy) {
-			log(L_USBRXTX,
-				"acx: allocated tx %d\n", head);
-			tx = &adev->usb_tx[head];
-			tx->busy = 1;
-			adev->hw_tx_queue[0].free--;
-			goto end;
+		map = adev->usb_tx_free_map;
+		if (unlikely(!map)) {
+			printk_ratelimited("acxusb: tx buffers full\n");
+			return NULL;
 		}
-	} while (likely(head != adev->hw_tx_queue[0].head));
-	tx = NULL;
-	printk_ratelimited("acxusb: tx buffers full\n");
+		txnum = __ffs(map);
+	} while (!test_and_clear_bit(txnum, &adev->usb_tx_free_map));
 
-	end:
-	adev->hw_tx_queue[0].head = head;
+	atomic_dec(&adev->usb_tx_free);
+	log(L_USBRXTX, "acx: allocated tx %u\n", txnum);
 
-	return (tx_t *) tx;
+	return (tx_t *) &adev->usb_tx[txnum];
 }
 
 /*
@@ -1207,7 +1259,8 @@ tx_t *acxusb_alloc_tx(acx_device_t *adev)
 void acxusb_dealloc_tx(tx_t * tx_opaque)
 {
 	usb_tx_t *tx = (usb_tx_t *) tx_opaque;
-	tx->busy = 0;
+
+	acxusb_free_tx_slot(tx->adev, tx);
 }
 
 void *acxusb_get_txbuf(acx_device_t * adev, tx_t * tx_opaque)
@@ -1216,6 +1269,129 @@ void *acxusb_get_txbuf(acx_device_t * adev, tx_t * tx_opaque)
 	return &tx->bulkout.data;
 }
 
+/*
+ * Tx aggregation
+ *
+ * While acx_tx_queue_go() is batching and txagg is set, frames are
+ * packed back to back into the current usb_tx_agg[] buffer, each one
+ * with its own usb_txbuffer_t header and hostdata. The tx status
+ * records are then still demuxed per usb_tx[] slot in
+ * acxusb_complete_rx(), as with one urb per frame. acxusb_tx_kick()
+ * sends the lot with a single bulk-out urb and moves on to the next
+ * buffer, so packing goes on while the previous aggregate is in
+ * flight. A frame that doesn't fit anymore starts the next one.
+ *
+ * It's not known whether every firmware version takes more than one
+ * frame per bulk-out transfer, so this is off by default. With txagg
+ * set, the tx_batch debugfs file shows the frames per urb.
+ */
+static void acxusb_complete_tx_agg(struct urb *urb)
+{
+	usb_tx_agg_t *agg = urb->context;
+	acx_device_t *adev = agg->adev;
+
+	if (unlikely(urb->status && urb->status != -ESHUTDOWN
+			&& urb->status != -ECONNRESET))
+		pr_err("tx agg error, urb status=%d\n", urb->status);
+
+	clear_bit(agg - adev->usb_tx_agg, &adev->usb_tx_agg_busy);
+}
+
+static void acxusb_reset_tx_agg(acx_device_t *adev)
+{
+	int i;
+
+	for (i = 0; i < ACX_USB_TX_AGG_BUFS; i++) {
+		adev->usb_tx_agg[i].len = 0;
+		adev->usb_tx_agg[i].nslots = 0;
+	}
+	adev->usb_tx_agg_cur = 0;
+	adev->tx_batch_pending = 0;
+	adev->usb_tx_agg_busy = 0;
+}
+
+/* Returns NOT_OK if the frame must be sent on its own */
+static int acxusb_tx_agg_add(acx_device_t *adev, usb_tx_t *tx, int size)
+{
+	usb_tx_agg_t *agg = &adev->usb_tx_agg[adev->usb_tx_agg_cur];
+
+	/* Full: send it, the frame starts the next one */
+	if (agg->len + size > ACX_USB_TX_AGG_LEN
+		|| agg->nslots >= ACX_TX_URB_MAX) {
+		acxusb_tx_kick(adev);
+		agg = &adev->usb_tx_agg[adev->usb_tx_agg_cur];
+	}
+
+	/* All aggregates in flight: don't wait for them */
+	if (test_bit(adev->usb_tx_agg_cur, &adev->usb_tx_agg_busy)
+		|| agg->len + size > ACX_USB_TX_AGG_LEN)
+		return NOT_OK;
+
+	memcpy(agg->buf + agg->len, &tx->bulkout, size);
+	agg->len += size;
+	agg->slot[agg->nslots++] = tx - adev->usb_tx;
+	adev->tx_batch_pending++;
+
+	return OK;
+}
+
+/* Frames of an aggregate that never went out: report them as not
+ * acked and give their slots back */
+static void acxusb_tx_agg_drop(acx_device_t *adev, usb_tx_agg_t *agg)
+{
+	usb_tx_t *tx;
+	unsigned int i;
+
+	for (i = 0; i < agg->nslots; i++) {
+		tx = &adev->usb_tx[agg->slot[i]];
+		adev->stats.tx_errors++;
+		if (tx->skb) {
+			ieee80211_tx_status(adev->hw, tx->skb);
+			tx->skb = NULL;
+		}
+		acxusb_free_tx_slot(adev, tx);
+	}
+	acx_tx_wake_hw_queue(adev, 0);
+}
+
+/* Sends the aggregate being filled, the next one takes new frames */
+void acxusb_tx_kick(acx_device_t *adev)
+{
+	unsigned int cur = adev->usb_tx_agg_cur;
+	usb_tx_agg_t *agg = &adev->usb_tx_agg[cur];
+	unsigned int n = agg->nslots;
+	int ucode;
+
+	if (!n)
+		return;
+
+	usb_fill_bulk_urb(agg->urb, adev->usbdev,
+			usb_sndbulkpipe(adev->usbdev, adev->bulkoutep),
+			agg->buf, agg->len, acxusb_complete_tx_agg, agg);
+	agg->urb->transfer_flags = URB_ASYNC_UNLINK | URB_ZERO_PACKET;
+
+	set_bit(cur, &adev->usb_tx_agg_busy);
+	ucode = usb_submit_urb(agg->urb, GFP_ATOMIC);
+	log(L_USBRXTX, "SUBMIT TX AGG (%u): frames=%u txsize=%u errcode=%d\n",
+		cur, n, agg->len, ucode);
+
+	if (unlikely(ucode)) {
+		pr_err("submit_urb() error=%d agg txsize=%u\n",
+			ucode, agg->len);
+		clear_bit(cur, &adev->usb_tx_agg_busy);
+		acxusb_tx_agg_drop(adev, agg);
+	} else {
+		adev->tx_doorbells++;
+		adev->tx_batch_hist[min_t(unsigned int, n,
+					ACX_TX_BATCH_HIST_LEN) - 1]++;
+		adev->usb_tx_agg_cur = (cur + 1) % ACX_USB_TX_AGG_BUFS;
+	}
+
+	agg->len = 0;
+	agg->nslots = 0;
+	adev->tx_batch_pending = 0;
+}
+
 /*
  * acxusb_tx_data
  *
@@ -1247,7 +1423,7 @@ void acxusb_tx_data(acx_device_t *adev, tx_t *tx_opaque, int wlanpkt_len,
 	txnum = tx - adev->usb_tx;
 
 	log(L_DEBUG, "using buf#%d free=%d len=%d\n",
-	    txnum, adev->hw_tx_queue[0].free, wlanpkt_len);
+	    txnum, atomic_read(&adev->usb_tx_free), wlanpkt_len);
 
 	/* fill the USB transfer header */
 	txbuf->desc = cpu_to_le16(USB_TXBUF_TXDESC);
@@ -1271,6 +1447,10 @@ void acxusb_tx_data(acx_device_t *adev, tx_t *tx_opaque, int wlanpkt_len,
 		acx_dump_bytes(txbuf, wlanpkt_len + USB_TXBUF_HDRSIZE);
 	}
 
+	if (adev->tx_batching
+		&& acxusb_tx_agg_add(adev, tx, wlanpkt_len + USB_TXBUF_HDRSIZE) == OK)
+		return;
+
 	if (unlikely(txurb->status == -EINPROGRESS)) {
 		pr_acx("trying to submit tx urb while already in progress\n");
 	}
@@ -1299,8 +1479,7 @@ void acxusb_tx_data(acx_device_t *adev, tx_t *tx_opaque, int wlanpkt_len,
 		 ** the statistics
 		 */
 		adev->stats.tx_errors++;
-		tx->busy = 0;
-		adev->hw_tx_queue[0].free++;
+		acxusb_free_tx_slot(adev, tx);
 		/* needed? if (adev->tx_free > TX_START_QUEUE) acx_wake_queue(...) */
 	}
 
@@ -1360,11 +1539,9 @@ void acxusb_i_tx_timeout(struct net_device *ndev)
 
 	acx_lock(adev, flags);
 */	/* unlink the URBs */
-/*	for (i = 0; i < ACX_TX_URB_CNT; i++) {
+/*	for (i = 0; i < adev->usb_tx_cnt; i++)
 		acxusb_unlink_urb(adev->usb_tx[i].urb);
-		adev->usb_tx[i].busy = 0;
-	}
-	adev->tx_free = ACX_TX_URB_CNT;
+	acxusb_reset_tx_slots(adev);
 */	/* TODO: stats update */
 /*	acx_unlock(adev, flags);
 
@@ -1410,16 +1587,17 @@ static int acxusb_op_start(struct ieee80211_hw *hw)
 	clear_bit(ACX_FLAG_HW_UP, &adev->flags);
 
 	/* Reset URBs status */
-	for (i = 0; i < ACX_RX_URB_CNT; i++) {
+	for (i = 0; i < adev->usb_rx_cnt; i++) {
 		adev->usb_rx[i].urb->status = 0;
 		adev->usb_rx[i].busy = 0;
 	}
+	adev->rxtruncsize = 0;
+	atomic_set(&adev->usb_rx_inflight, 0);
+	adev->usb_rx_seq_submit = 0;
+	adev->usb_rx_seq_expect = 0;
 
-	for (i = 0; i < ACX_TX_URB_CNT; i++) {
-		adev->usb_tx[i].urb->status = 0;
-		adev->usb_tx[i].busy = 0;
-	}
-	adev->hw_tx_queue[0].free = ACX_TX_URB_CNT;
+	acxusb_reset_tx_slots(adev);
+	acxusb_reset_tx_agg(adev);
 
 	/* put the ACX100 out of sleep mode */
 	acx_issue_cmd(adev, ACX1xx_CMD_WAKE, NULL, 0);
@@ -1427,10 +1605,12 @@ static int acxusb_op_start(struct ieee80211_hw *hw)
 	/* acx_start needs it */
 	acx_update_settings(adev);
 
-	acxusb_poll_rx(adev, &adev->usb_rx[0]);
-
+	/* HW_UP first, complete_rx() drops urbs completing without it */
 	set_bit(ACX_FLAG_HW_UP, &adev->flags);
 
+	for (i = 0; i < adev->usb_rx_cnt; i++)
+		acxusb_poll_rx(adev, &adev->usb_rx[i]);
+
 	acx_wake_queue(adev->hw, NULL);
 
 	acx_sem_unlock(adev);
@@ -1474,15 +1654,16 @@ static void acxusb_op_stop(struct ieee80211_hw *hw)
 
 	/* stop pending rx/tx urb transfers */
 	// OW TODO Maybe we need to report pending skbs in urbs still to mac80211 ? see wl1251 flush
-	for (i = 0; i < ACX_TX_URB_CNT; i++) {
+	for (i = 0; i < adev->usb_tx_cnt; i++)
 		acxusb_unlink_urb(adev->usb_tx[i].urb);
-		adev->usb_tx[i].busy = 0;
-	}
-	for (i = 0; i < ACX_RX_URB_CNT; i++) {
+	for (i = 0; i < adev->usb_rx_cnt; i++) {
 		acxusb_unlink_urb(adev->usb_rx[i].urb);
 		adev->usb_rx[i].busy = 0;
 	}
-	adev->hw_tx_queue[0].free = ACX_TX_URB_CNT;
+	for (i = 0; i < ACX_USB_TX_AGG_BUFS; i++)
+		acxusb_unlink_urb(adev->usb_tx_agg[i].urb);
+	acxusb_reset_tx_agg(adev);
+	acxusb_reset_tx_slots(adev);
 
 	adev->channel = 1;
 
@@ -1677,19 +1858,29 @@ acxusb_probe(struct usb_interface *intf, const struct usb_device_id *devID)
 	    (int)TXBUFSIZE, (int)RXBUFSIZE);
 
 	/* Allocate the RX/TX containers. */
-	adev->usb_tx = kmalloc(sizeof(usb_tx_t) * ACX_TX_URB_CNT, GFP_KERNEL);
+	adev->usb_tx_cnt = clamp_t(unsigned int, acx_usb_tx_urbs,
+				ACX_TX_URB_MIN, ACX_TX_URB_MAX);
+	if (adev->usb_tx_cnt != acx_usb_tx_urbs)
+		pr_acxusb("txurbs=%u out of range, using %u\n",
+			acx_usb_tx_urbs, adev->usb_tx_cnt);
+	adev->usb_tx = kzalloc(sizeof(usb_tx_t) * adev->usb_tx_cnt, GFP_KERNEL);
 	if (!adev->usb_tx) {
 		msg = "acx: no memory for tx container";
 		goto end_nomem;
 	}
-	adev->usb_rx = kmalloc(sizeof(usb_rx_t) * ACX_RX_URB_CNT, GFP_KERNEL);
+	adev->usb_rx_cnt = clamp_t(unsigned int, acx_usb_rx_urbs,
+				ACX_RX_URB_MIN, ACX_RX_URB_MAX);
+	if (adev->usb_rx_cnt != acx_usb_rx_urbs)
+		pr_acxusb("rxurbs=%u out of range, using %u\n",
+			acx_usb_rx_urbs, adev->usb_rx_cnt);
+	adev->usb_rx = kzalloc(sizeof(usb_rx_t) * adev->usb_rx_cnt, GFP_KERNEL);
 	if (!adev->usb_rx) {
 		msg = "acx: no memory for rx container";
 		goto end_nomem;
 	}
 
 	/* Setup URBs for bulk-in/out messages */
-	for (i = 0; i < ACX_RX_URB_CNT; i++) {
+	for (i = 0; i < adev->usb_rx_cnt; i++) {
 		adev->usb_rx[i].urb = usb_alloc_urb(0, GFP_KERNEL);
 		if (!adev->usb_rx[i].urb) {
 			msg = "acx: no memory for input URB\n";
@@ -1700,17 +1891,27 @@ acxusb_probe(struct usb_interface *intf, const struct usb_device_id *devID)
 		adev->usb_rx[i].busy = 0;
 	}
 
-	for (i = 0; i < ACX_TX_URB_CNT; i++) {
+	for (i = 0; i < adev->usb_tx_cnt; i++) {
 		adev->usb_tx[i].urb = usb_alloc_urb(0, GFP_KERNEL);
 		if (!adev->usb_tx[i].urb) {
 			msg = "acx: no memory for output URB\n";
 			goto end_nomem;
 		}
-		adev->usb_tx[i].urb->status = 0;
 		adev->usb_tx[i].adev = adev;
-		adev->usb_tx[i].busy = 0;
 	}
-	adev->hw_tx_queue[0].free = ACX_TX_URB_CNT;
+	acxusb_reset_tx_slots(adev);
+
+	for (i = 0; i < ACX_USB_TX_AGG_BUFS; i++) {
+		adev->usb_tx_agg[i].adev = adev;
+		adev->usb_tx_agg[i].urb = usb_alloc_urb(0, GFP_KERNEL);
+		adev->usb_tx_agg[i].buf = kmalloc(ACX_USB_TX_AGG_LEN,
+						GFP_KERNEL);
+		if (!adev->usb_tx_agg[i].urb || !adev->usb_tx_agg[i].buf) {
+			msg = "acx: no memory for tx aggregation\n";
+			goto end_nomem;
+		}
+	}
+	acxusb_reset_tx_agg(adev);
 
 	/* TODO: move all of fw cmds to open()? But then we won't know our MAC addr
 	   until ifup (it's available via reading ACX1xx_IE_DOT11_STATION_ID)... */
@@ -1718,6 +1919,7 @@ acxusb_probe(struct usb_interface *intf, const struct usb_device_id *devID)
 	/* put acx out of sleep mode and initialize it */
 	acx_issue_cmd(adev, ACX1xx_CMD_WAKE, NULL, 0);
 
+	acx_init_ring_sizes(adev);
 	result = acx_init_mac(adev);
 	if (result)
 		goto end;
@@ -1761,15 +1963,19 @@ acxusb_probe(struct usb_interface *intf, const struct usb_device_id *devID)
 
 	if (hw) {
 		if (adev->usb_rx) {
-			for (i = 0; i < ACX_RX_URB_CNT; i++)
+			for (i = 0; i < adev->usb_rx_cnt; i++)
 				usb_free_urb(adev->usb_rx[i].urb);
 			kfree(adev->usb_rx);
 		}
 		if (adev->usb_tx) {
-			for (i = 0; i < ACX_TX_URB_CNT; i++)
+			for (i = 0; i < adev->usb_tx_cnt; i++)
 				usb_free_urb(adev->usb_tx[i].urb);
 			kfree(adev->usb_tx);
 		}
+		for (i = 0; i < ACX_USB_TX_AGG_BUFS; i++) {
+			usb_free_urb(adev->usb_tx_agg[i].urb);
+			kfree(adev->usb_tx_agg[i].buf);
+		}
 		ieee80211_free_hw(hw);
 	}
 
@@ -1826,16 +2032,20 @@ static void acxusb_disconnect(struct usb_interface *intf)
 	 * Here we only free them. _close() took care of
 	 * unlinking them.
 	 */
-	for (i = 0; i < ACX_RX_URB_CNT; ++i) {
+	for (i = 0; i < adev->usb_rx_cnt; ++i) {
 		usb_free_urb(adev->usb_rx[i].urb);
 	}
-	for (i = 0; i < ACX_TX_URB_CNT; ++i) {
+	for (i = 0; i < adev->usb_tx_cnt; ++i) {
 		usb_free_urb(adev->usb_tx[i].urb);
 	}
+	for (i = 0; i < ACX_USB_TX_AGG_BUFS; i++)
+		usb_free_urb(adev->usb_tx_agg[i].urb);
 
 	/* Freeing containers */
 	kfree(adev->usb_rx);
 	kfree(adev->usb_tx);
+	for (i = 0; i < ACX_USB_TX_AGG_BUFS; i++)
+		kfree(adev->usb_tx_agg[i].buf);
 
 	acx_sem_unlock(adev);
 
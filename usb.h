@@ -49,6 +49,7 @@ tx_t *acxusb_alloc_tx(acx_device_t *adev);
 void acxusb_dealloc_tx(tx_t * tx_opaque);
 void *acxusb_get_txbuf(acx_device_t * adev, tx_t * tx_opaque);
 void acxusb_tx_data(acx_device_t *adev, tx_t *tx_opaque, int wlanpkt_len, struct ieee80211_tx_info *ieeectl, struct sk_buff *skb);
+void acxusb_tx_kick(acx_device_t *adev);
 
 /* Irq Handling, Timer */
 void acxusb_irq_work(struct work_struct *work);
@@ -105,6 +106,9 @@ static inline void acxusb_tx_data(acx_device_t *adev, tx_t *tx_opaque, int wlanp
 				struct ieee80211_tx_info *ieeectl, struct sk_buff *skb)
 {}
 
+static inline void acxusb_tx_kick(acx_device_t *adev)
+{}
+
 static inline void acxusb_irq_work(struct work_struct *work)
 {}
 